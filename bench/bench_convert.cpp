@@ -0,0 +1,226 @@
+// Microbenchmark for the CPU pixel-format converters on synthetic frames.
+// Prints one JSON document to stdout; progress goes to stderr.
+//
+//   rock5b_bench_convert [--frames N] [--threads N] [--filter SUBSTR]
+
+#include "convert_pool.h"
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Resolution {
+  const char* name;
+  uint32_t width;
+  uint32_t height;
+};
+
+constexpr Resolution kResolutions[] = {
+    {"720p", 1280, 720},
+    {"1080p", 1920, 1080},
+    {"4k", 3840, 2160},
+};
+
+enum class Format { NV12, NV24, YUYV, UYVY, BGR24 };
+
+struct FormatInfo {
+  Format format;
+  const char* name;
+  bool has_uv_swap;
+  bool has_stride;  // bgr24_to_rgb24 assumes tightly packed rows
+};
+
+constexpr FormatInfo kFormats[] = {
+    {Format::NV12, "nv12", true, true},
+    {Format::NV24, "nv24", true, true},
+    {Format::YUYV, "yuyv", false, true},
+    {Format::UYVY, "uyvy", false, true},
+    {Format::BGR24, "bgr24", false, false},
+};
+
+struct Case {
+  const FormatInfo* fmt;
+  const Resolution* res;
+  bool padded;
+  bool uv_swap;
+};
+
+struct Source {
+  std::vector<uint8_t> plane0;
+  std::vector<uint8_t> plane1;
+  uint32_t stride0 = 0;
+  uint32_t stride1 = 0;
+  size_t bytes = 0;  // bytes the converter actually reads
+};
+
+uint32_t padded_stride(uint32_t row_bytes, bool padded) {
+  // Padded rows mimic drivers that align bytesperline and leave slack after each line.
+  return padded ? ((row_bytes + 255u) & ~255u) + 256u : row_bytes;
+}
+
+void fill_random(std::vector<uint8_t>& v, uint32_t& seed) {
+  for (auto& b : v) {
+    seed = seed * 1664525u + 1013904223u;
+    b = (uint8_t)(seed >> 24);
+  }
+}
+
+Source make_source(const Case& c) {
+  const uint32_t w = c.res->width;
+  const uint32_t h = c.res->height;
+  Source s;
+  uint32_t seed = 12345;
+  switch (c.fmt->format) {
+    case Format::NV12:
+      s.stride0 = padded_stride(w, c.padded);
+      s.stride1 = s.stride0;
+      s.plane0.resize((size_t)s.stride0 * h);
+      s.plane1.resize((size_t)s.stride1 * (h / 2));
+      s.bytes = (size_t)w * h + (size_t)w * (h / 2);
+      break;
+    case Format::NV24:
+      s.stride0 = padded_stride(w, c.padded);
+      s.stride1 = padded_stride(w * 2, c.padded);
+      s.plane0.resize((size_t)s.stride0 * h);
+      s.plane1.resize((size_t)s.stride1 * h);
+      s.bytes = (size_t)w * h * 3;
+      break;
+    case Format::YUYV:
+    case Format::UYVY:
+      s.stride0 = padded_stride(w * 2, c.padded);
+      s.plane0.resize((size_t)s.stride0 * h);
+      s.bytes = (size_t)w * h * 2;
+      break;
+    case Format::BGR24:
+      s.stride0 = w * 3;
+      s.plane0.resize((size_t)s.stride0 * h);
+      s.bytes = (size_t)w * h * 3;
+      break;
+  }
+  fill_random(s.plane0, seed);
+  fill_random(s.plane1, seed);
+  return s;
+}
+
+bool run_once(const Case& c, const Source& s, uint8_t* dst, ConvertPool* pool) {
+  const uint32_t w = c.res->width;
+  const uint32_t h = c.res->height;
+  const Colorimetry cs;
+  switch (c.fmt->format) {
+    case Format::NV12:
+      return nv12_to_rgb24(s.plane0.data(), s.plane1.data(), w, h, s.stride0, s.stride1, c.uv_swap, cs, dst, pool);
+    case Format::NV24:
+      return nv24_to_rgb24(s.plane0.data(), s.plane1.data(), w, h, s.stride0, s.stride1, c.uv_swap, cs, dst, pool);
+    case Format::YUYV:
+      return yuyv_to_rgb24(s.plane0.data(), w, h, s.stride0, cs, dst, pool);
+    case Format::UYVY:
+      return uyvy_to_rgb24(s.plane0.data(), w, h, s.stride0, cs, dst, pool);
+    case Format::BGR24:
+      return bgr24_to_rgb24(s.plane0.data(), w, h, dst, pool);
+  }
+  return false;
+}
+
+int64_t now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+double percentile(const std::vector<int64_t>& sorted, double p) {
+  if (sorted.empty()) return 0.0;
+  const size_t i = std::min(sorted.size() - 1, (size_t)(p * (double)(sorted.size() - 1) + 0.5));
+  return (double)sorted[i];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint32_t frames = 100;
+  uint32_t threads = 1;
+  std::string filter;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--frames" && i + 1 < argc) {
+      frames = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::string(argv[i]) == "--threads" && i + 1 < argc) {
+      threads = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::string(argv[i]) == "--filter" && i + 1 < argc) {
+      filter = argv[++i];
+    } else {
+      std::fprintf(stderr, "usage: %s [--frames N] [--threads N (0=auto)] [--filter SUBSTR]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (frames == 0) frames = 1;
+
+  ConvertPool pool;
+  if (threads != 1) pool.start(threads, false);
+
+  std::vector<Case> cases;
+  for (const auto& fmt : kFormats) {
+    for (const auto& res : kResolutions) {
+      for (int padded = 0; padded < (fmt.has_stride ? 2 : 1); padded++) {
+        for (int swap = 0; swap < (fmt.has_uv_swap ? 2 : 1); swap++) {
+          cases.push_back({&fmt, &res, padded != 0, swap != 0});
+        }
+      }
+    }
+  }
+
+  std::printf("{\n  \"kernels\": \"%s\",\n  \"threads\": %u,\n  \"frames\": %u,\n  \"results\": [",
+              convert_kernels().name, pool.thread_count(), frames);
+
+  bool first = true;
+  for (const Case& c : cases) {
+    char label[96];
+    std::snprintf(label, sizeof(label), "%s/%s/%s%s", c.fmt->name, c.res->name,
+                  c.padded ? "padded" : "unpadded", c.fmt->has_uv_swap ? (c.uv_swap ? "/swap" : "/noswap") : "");
+    if (!filter.empty() && std::strstr(label, filter.c_str()) == nullptr) continue;
+    std::fprintf(stderr, "[bench_convert] %s\n", label);
+
+    const Source src = make_source(c);
+    const size_t pixels = (size_t)c.res->width * c.res->height;
+    std::vector<uint8_t> dst(pixels * 3);
+
+    // Warm caches, page in the destination and let the pool threads spin up.
+    for (int i = 0; i < 3; i++) run_once(c, src, dst.data(), &pool);
+
+    std::vector<int64_t> ns;
+    ns.reserve(frames);
+    for (uint32_t i = 0; i < frames; i++) {
+      const int64_t t0 = now_ns();
+      if (!run_once(c, src, dst.data(), &pool)) {
+        std::fprintf(stderr, "[bench_convert] %s: converter failed\n", label);
+        return 1;
+      }
+      ns.push_back(now_ns() - t0);
+    }
+
+    double total = 0.0;
+    for (int64_t v : ns) total += (double)v;
+    const double mean = total / (double)ns.size();
+    std::sort(ns.begin(), ns.end());
+
+    // Bytes read from the source plus the RGB24 bytes written, per second.
+    const double gbps = (double)(src.bytes + pixels * 3) / mean;
+
+    std::printf("%s\n    {\"format\": \"%s\", \"resolution\": \"%s\", \"width\": %u, \"height\": %u, "
+                "\"padded\": %s, \"uv_swap\": %s, \"stride\": %u, "
+                "\"ns_per_pixel\": %.4f, \"gb_per_s\": %.3f, \"p50_ms\": %.3f, \"p99_ms\": %.3f}",
+                first ? "" : ",", c.fmt->name, c.res->name, c.res->width, c.res->height,
+                c.padded ? "true" : "false", c.uv_swap ? "true" : "false", src.stride0,
+                mean / (double)pixels, gbps, percentile(ns, 0.50) / 1e6, percentile(ns, 0.99) / 1e6);
+    first = false;
+  }
+
+  std::printf("\n  ]\n}\n");
+  return 0;
+}
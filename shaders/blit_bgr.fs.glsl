@@ -0,0 +1,7 @@
+precision mediump float;
+varying vec2 v_uv;
+// BGR24 capture buffer sampled as RGB: swap R and B back.
+uniform sampler2D u_tex;
+void main(){
+  gl_FragColor = vec4(texture2D(u_tex, v_uv).bgr, 1.0);
+}
@@ -0,0 +1,19 @@
+precision mediump float;
+varying vec2 v_uv;
+// Three-plane 4:2:0 (YUV420M): one single-channel texture per plane, imported as R8 or
+// uploaded as LUMINANCE, so .r works for both.
+uniform sampler2D u_tex_y;
+uniform sampler2D u_tex_u;
+uniform sampler2D u_tex_v;
+uniform int u_uvSwap;
+// YCbCr -> RGB for the negotiated colorimetry (see colorimetry.h).
+uniform mat3 u_yuvMat;
+uniform vec3 u_yuvOffset;
+void main(){
+  float y = texture2D(u_tex_y, v_uv).r;
+  float cb = texture2D(u_tex_u, v_uv).r;
+  float cr = texture2D(u_tex_v, v_uv).r;
+  float u = (u_uvSwap == 0) ? cb : cr;
+  float v = (u_uvSwap == 0) ? cr : cb;
+  gl_FragColor = vec4(u_yuvMat * vec3(y, u, v) + u_yuvOffset, 1.0);
+}
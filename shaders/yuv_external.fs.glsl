@@ -0,0 +1,8 @@
+#extension GL_OES_EGL_image_external : require
+precision mediump float;
+varying vec2 v_uv;
+// NV12/NV16/NV24/YUV420M EGLImage; the sampler returns RGB using the colorimetry hints given at import.
+uniform samplerExternalOES u_tex;
+void main(){
+  gl_FragColor = texture2D(u_tex, v_uv);
+}
@@ -0,0 +1,21 @@
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
+precision mediump float;
+#endif
+varying vec2 v_uv;
+// Packed 4:2:2 (YUYV/UYVY) as a half-width RGBA texture: one texel per pixel pair.
+uniform sampler2D u_tex;
+uniform vec2 u_texSize;
+uniform int u_uyvy;
+// YCbCr -> RGB for the negotiated colorimetry (see colorimetry.h).
+uniform mat3 u_yuvMat;
+uniform vec3 u_yuvOffset;
+void main(){
+  vec4 t = texture2D(u_tex, v_uv);
+  // Normalize to Y0 U Y1 V.
+  vec4 p = (u_uyvy == 0) ? t : t.gras;
+  float odd = step(0.5, fract(v_uv.x * u_texSize.x));
+  float y = mix(p.x, p.z, odd);
+  gl_FragColor = vec4(u_yuvMat * vec3(y, p.y, p.w) + u_yuvOffset, 1.0);
+}
@@ -0,0 +1,26 @@
+#include "alloc_counter.h"
+
+#ifndef NDEBUG
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic_uint64_t g_alloc_count{0};
+
+void* operator new(std::size_t n) {
+  g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+uint64_t alloc_count() { return g_alloc_count.load(std::memory_order_relaxed); }
+
+#else
+
+uint64_t alloc_count() { return 0; }
+
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of global operator new calls so far. Only counted in debug builds (NDEBUG unset),
+// where it is used to check that the steady-state render loop does not allocate;
+// always 0 otherwise.
+uint64_t alloc_count();
+
+constexpr bool alloc_counter_enabled() {
+#ifndef NDEBUG
+  return true;
+#else
+  return false;
+#endif
+}
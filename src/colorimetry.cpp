@@ -0,0 +1,56 @@
+#include "colorimetry.h"
+
+#include <linux/videodev2.h>
+
+YuvShaderMatrix yuv_shader_matrix(Colorimetry c) {
+  const YuvCoeffs k = yuv_coeffs(c);
+  YuvShaderMatrix m{};
+  // Columns: Y, U, V.
+  const double cols[3][3] = {
+      {k.y, k.y, k.y},
+      {0.0, -k.gu, k.bu},
+      {k.rv, -k.gv, 0.0},
+  };
+  const double bias[3] = {k.y_offset / 255.0, 128.0 / 255.0, 128.0 / 255.0};
+  for (int row = 0; row < 3; row++) {
+    double off = 0.0;
+    for (int col = 0; col < 3; col++) {
+      m.mat[col * 3 + row] = (float)cols[col][row];
+      off -= cols[col][row] * bias[col];
+    }
+    m.offset[row] = (float)off;
+  }
+  return m;
+}
+
+Colorimetry colorimetry_from_v4l2(uint32_t colorspace, uint32_t ycbcr_enc, uint32_t quantization) {
+  if (ycbcr_enc == V4L2_YCBCR_ENC_DEFAULT) ycbcr_enc = V4L2_MAP_YCBCR_ENC_DEFAULT(colorspace);
+  if (quantization == V4L2_QUANTIZATION_DEFAULT) quantization = V4L2_MAP_QUANTIZATION_DEFAULT(false, colorspace, ycbcr_enc);
+
+  Colorimetry c;
+  switch (ycbcr_enc) {
+    case V4L2_YCBCR_ENC_709:
+    case V4L2_YCBCR_ENC_XV709:
+    case V4L2_YCBCR_ENC_SMPTE240M:  // close enough to BT.709 for display
+      c.matrix = YuvMatrix::Bt709;
+      break;
+    case V4L2_YCBCR_ENC_BT2020:
+    case V4L2_YCBCR_ENC_BT2020_CONST_LUM:
+      c.matrix = YuvMatrix::Bt2020;
+      break;
+    default:
+      c.matrix = YuvMatrix::Bt601;
+      break;
+  }
+  c.range = (quantization == V4L2_QUANTIZATION_FULL_RANGE) ? YuvRange::Full : YuvRange::Limited;
+  return c;
+}
+
+const char* colorimetry_name(Colorimetry c) {
+  static const char* const names[kColorimetryCount] = {
+      "bt601-limited", "bt601-full",
+      "bt709-limited", "bt709-full",
+      "bt2020-limited", "bt2020-full",
+  };
+  return names[colorimetry_index(c)];
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+// YCbCr -> RGB conversion negotiated with the capture driver (VIDIOC_G_FMT colorspace,
+// ycbcr_enc and quantization). Shared by the CPU kernels and the shaders.
+enum class YuvMatrix : uint8_t { Bt601 = 0, Bt709 = 1, Bt2020 = 2 };
+enum class YuvRange : uint8_t { Limited = 0, Full = 1 };
+
+struct Colorimetry {
+  YuvMatrix matrix = YuvMatrix::Bt601;
+  YuvRange range = YuvRange::Limited;
+};
+
+constexpr int kColorimetryCount = 6;
+
+constexpr int colorimetry_index(Colorimetry c) { return (int)c.matrix * 2 + (int)c.range; }
+constexpr Colorimetry colorimetry_from_index(int i) { return {(YuvMatrix)(i / 2), (YuvRange)(i % 2)}; }
+
+// rgb = Y' * y + (0, -gu, bu) * U' + (rv, -gv, 0) * V' on 8-bit code values,
+// where Y' = Y - y_offset, U' = U - 128, V' = V - 128.
+struct YuvCoeffs {
+  double y, rv, gu, gv, bu;
+  int y_offset;
+};
+
+constexpr YuvCoeffs yuv_coeffs(Colorimetry c) {
+  const double kr = (c.matrix == YuvMatrix::Bt709) ? 0.2126 : (c.matrix == YuvMatrix::Bt2020) ? 0.2627 : 0.299;
+  const double kb = (c.matrix == YuvMatrix::Bt709) ? 0.0722 : (c.matrix == YuvMatrix::Bt2020) ? 0.0593 : 0.114;
+  const double kg = 1.0 - kr - kb;
+  const bool limited = (c.range == YuvRange::Limited);
+  const double ys = limited ? 255.0 / 219.0 : 1.0;
+  const double cs = limited ? 255.0 / 224.0 : 1.0;
+  return {ys,
+          2.0 * (1.0 - kr) * cs,
+          2.0 * kb * (1.0 - kb) / kg * cs,
+          2.0 * kr * (1.0 - kr) / kg * cs,
+          2.0 * (1.0 - kb) * cs,
+          limited ? 16 : 0};
+}
+
+// 8.8 fixed-point form used by the CPU kernels.
+struct YuvFixedCoeffs {
+  int y, rv, gu, gv, bu;
+  int y_offset;
+};
+
+constexpr int fixed_8_8(double v) { return (int)(v * 256.0 + 0.5); }
+
+constexpr YuvFixedCoeffs yuv_fixed_coeffs(Colorimetry c) {
+  const YuvCoeffs k = yuv_coeffs(c);
+  return {fixed_8_8(k.y), fixed_8_8(k.rv), fixed_8_8(k.gu), fixed_8_8(k.gv), fixed_8_8(k.bu), k.y_offset};
+}
+
+template <int CS>
+constexpr YuvFixedCoeffs kYuvFixedCoeffs = yuv_fixed_coeffs(colorimetry_from_index(CS));
+
+static_assert(kYuvFixedCoeffs<0>.y == 298 && kYuvFixedCoeffs<0>.rv == 409 && kYuvFixedCoeffs<0>.gu == 100 &&
+                  kYuvFixedCoeffs<0>.gv == 208 && kYuvFixedCoeffs<0>.bu == 516,
+              "BT.601 limited range must keep the classic integer coefficients");
+
+// Shader form: rgb = mat * yuv + offset with samples and output normalised to [0, 1].
+// `mat` is column-major, ready for glUniformMatrix3fv.
+struct YuvShaderMatrix {
+  float mat[9];
+  float offset[3];
+};
+
+YuvShaderMatrix yuv_shader_matrix(Colorimetry c);
+
+// Maps V4L2 colorspace/ycbcr_enc/quantization (including their DEFAULT values) to a matrix and range.
+Colorimetry colorimetry_from_v4l2(uint32_t colorspace, uint32_t ycbcr_enc, uint32_t quantization);
+
+const char* colorimetry_name(Colorimetry c);
@@ -0,0 +1,155 @@
+#include "convert_pool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <pthread.h>
+#include <sched.h>
+
+static long read_cpu_sysfs_long(int cpu, const char* leaf) {
+  std::ifstream f("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/" + leaf);
+  long v = -1;
+  if (f.is_open()) f >> v;
+  return f ? v : -1;
+}
+
+// CPUs of the fastest cluster that we are allowed to run on; empty if all cores look alike.
+static std::vector<int> find_big_cores() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return {};
+
+  std::vector<std::pair<int, long>> caps;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (!CPU_ISSET(cpu, &allowed)) continue;
+    long c = read_cpu_sysfs_long(cpu, "cpu_capacity");
+    if (c < 0) c = read_cpu_sysfs_long(cpu, "cpufreq/cpuinfo_max_freq");
+    caps.emplace_back(cpu, c);
+  }
+  if (caps.empty()) return {};
+
+  long best = -1;
+  long worst = -1;
+  for (const auto& c : caps) {
+    best = std::max(best, c.second);
+    worst = (worst < 0) ? c.second : std::min(worst, c.second);
+  }
+  if (best <= 0 || best == worst) return {};
+
+  std::vector<int> out;
+  for (const auto& c : caps) {
+    if (c.second == best) out.push_back(c.first);
+  }
+  return out;
+}
+
+bool ConvertPool::start(uint32_t threads, bool debug) {
+  stop();
+
+  const std::vector<int> big = find_big_cores();
+  if (threads == 0) {
+    const uint32_t ncores = big.empty() ? std::thread::hardware_concurrency() : (uint32_t)big.size();
+    threads = std::min<uint32_t>(4, std::max<uint32_t>(1, ncores));
+  }
+  if (threads <= 1) return true;
+
+  quit_ = false;
+  generation_ = 0;
+  busy_workers_ = 0;
+  // Pin helpers to the big cores after the first, which no helper gets. The calling thread
+  // (render or capture thread) runs a share itself and is left unpinned.
+  for (uint32_t i = 0; i + 1 < threads; i++) {
+    const int cpu = big.empty() ? -1 : big[(i + 1) % big.size()];
+    workers_.emplace_back(&ConvertPool::worker_main, this, i, cpu);
+  }
+
+  if (debug) {
+    std::string cpus;
+    for (int c : big) cpus += (cpus.empty() ? "" : ",") + std::to_string(c);
+    std::fprintf(stderr, "[convert_pool] %u threads (big cores: %s)\n", thread_count(), cpus.empty() ? "n/a" : cpus.c_str());
+  }
+  return true;
+}
+
+void ConvertPool::stop() {
+  if (workers_.empty()) return;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    quit_ = true;
+  }
+  cv_work_.notify_all();
+  for (auto& t : workers_) t.join();
+  workers_.clear();
+}
+
+void ConvertPool::worker_main(uint32_t worker_index, int cpu) {
+  char name[16];
+  std::snprintf(name, sizeof(name), "convert/%u", worker_index);
+  pthread_setname_np(pthread_self(), name);
+  if (cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  uint64_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(mu_);
+      cv_work_.wait(lk, [&] { return quit_ || generation_ != seen; });
+      if (quit_) return;
+      seen = generation_;
+    }
+    run_stripes();
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (--busy_workers_ == 0) cv_done_.notify_one();
+    }
+  }
+}
+
+void ConvertPool::run_stripes() {
+  while (true) {
+    const uint32_t s = next_stripe_.fetch_add(1, std::memory_order_relaxed);
+    if (s >= stripe_count_) return;
+    const uint32_t y0 = s * stripe_rows_;
+    const uint32_t y1 = std::min(rows_, y0 + stripe_rows_);
+    fn_(ctx_, y0, y1);
+  }
+}
+
+void ConvertPool::run(uint32_t rows, StripeFn fn, void* ctx) {
+  if (rows == 0) return;
+  if (workers_.empty()) {
+    fn(ctx, 0, rows);
+    return;
+  }
+
+  // Two stripes per thread keeps the tail short if one core gets preempted. Even stripe
+  // heights keep 4:2:0 chroma rows within a single stripe.
+  const uint32_t stripes_wanted = thread_count() * 2;
+  uint32_t stripe_rows = (rows + stripes_wanted - 1) / stripes_wanted;
+  stripe_rows = (stripe_rows + 1) & ~1u;
+
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    fn_ = fn;
+    ctx_ = ctx;
+    rows_ = rows;
+    stripe_rows_ = stripe_rows;
+    stripe_count_ = (rows + stripe_rows - 1) / stripe_rows;
+    next_stripe_.store(0, std::memory_order_relaxed);
+    busy_workers_ = (uint32_t)workers_.size();
+    generation_++;
+  }
+  cv_work_.notify_all();
+
+  run_stripes();
+
+  // Completion barrier: every worker has finished its last stripe.
+  std::unique_lock<std::mutex> lk(mu_);
+  cv_done_.wait(lk, [&] { return busy_workers_ == 0; });
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Persistent worker pool for the CPU conversion paths. run() splits a frame into row stripes,
+// executes them on the workers plus the calling thread, and returns once every stripe is done.
+// Workers are pinned to the fastest cores (cpu_capacity / cpuinfo_max_freq) when they differ.
+class ConvertPool {
+public:
+  using StripeFn = void (*)(void* ctx, uint32_t y0, uint32_t y1);
+
+  ConvertPool() = default;
+  ConvertPool(const ConvertPool&) = delete;
+  ConvertPool& operator=(const ConvertPool&) = delete;
+  ~ConvertPool() { stop(); }
+
+  // threads counts the calling thread too; 0 picks min(4, number of big cores).
+  bool start(uint32_t threads, bool debug);
+  void stop();
+
+  bool running() const { return !workers_.empty(); }
+  uint32_t thread_count() const { return (uint32_t)workers_.size() + 1; }
+
+  void run(uint32_t rows, StripeFn fn, void* ctx);
+
+private:
+  void worker_main(uint32_t worker_index, int cpu);
+  void run_stripes();
+
+  std::vector<std::thread> workers_;
+
+  std::mutex mu_;
+  std::condition_variable cv_work_;
+  std::condition_variable cv_done_;
+  uint64_t generation_ = 0;
+  uint32_t busy_workers_ = 0;
+  bool quit_ = false;
+
+  // Current job; written by run() before bumping generation_.
+  StripeFn fn_ = nullptr;
+  void* ctx_ = nullptr;
+  uint32_t rows_ = 0;
+  uint32_t stripe_rows_ = 0;
+  uint32_t stripe_count_ = 0;
+  std::atomic_uint32_t next_stripe_{0};
+};
+
+// Runs fn(y) for y in [0, rows), striped over the pool when it is running, inline otherwise.
+template <typename RowFn>
+void convert_rows(ConvertPool* pool, uint32_t rows, RowFn&& fn) {
+  if (!pool || !pool->running()) {
+    for (uint32_t y = 0; y < rows; y++) fn(y);
+    return;
+  }
+  using Fn = std::remove_reference_t<RowFn>;
+  auto stripe = [](void* ctx, uint32_t y0, uint32_t y1) {
+    auto& f = *static_cast<Fn*>(ctx);
+    for (uint32_t y = y0; y < y1; y++) f(y);
+  };
+  pool->run(rows, stripe, (void*)std::addressof(fn));
+}
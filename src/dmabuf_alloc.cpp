@@ -0,0 +1,62 @@
+#include "dmabuf_alloc.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/dma-heap.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+bool DmaHeap::open(const std::string& path) {
+  close();
+
+  // CMA first: physically contiguous buffers import everywhere, including into display
+  // planes without an IOMMU. The system heap only works for IOMMU-backed importers.
+  static const char* const kDefaultHeaps[] = {"/dev/dma_heap/linux,cma", "/dev/dma_heap/system"};
+  if (!path.empty()) {
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ >= 0) path_ = path;
+  } else {
+    for (const char* p : kDefaultHeaps) {
+      fd_ = ::open(p, O_RDONLY | O_CLOEXEC);
+      if (fd_ >= 0) {
+        path_ = p;
+        break;
+      }
+    }
+  }
+  if (fd_ < 0) {
+    std::fprintf(stderr, "[dmabuf_alloc] cannot open dma-heap %s: %s\n", path.empty() ? "(linux,cma|system)" : path.c_str(),
+                 std::strerror(errno));
+    return false;
+  }
+  std::fprintf(stderr, "[dmabuf_alloc] using dma-heap %s\n", path_.c_str());
+  return true;
+}
+
+void DmaHeap::close() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+  path_.clear();
+}
+
+int DmaHeap::alloc(size_t size) const {
+  if (fd_ < 0 || size == 0) return -1;
+  dma_heap_allocation_data data{};
+  data.len = size;
+  data.fd_flags = O_RDWR | O_CLOEXEC;
+  if (ioctl(fd_, DMA_HEAP_IOCTL_ALLOC, &data) < 0) {
+    std::fprintf(stderr, "[dmabuf_alloc] DMA_HEAP_IOCTL_ALLOC(%zu) on %s failed: %s\n", size, path_.c_str(), std::strerror(errno));
+    return -1;
+  }
+  return (int)data.fd;
+}
+
+DmabufAllocator DmaHeap::allocator() {
+  DmabufAllocator a;
+  a.name = "dma-heap";
+  a.ctx = this;
+  a.alloc = [](void* ctx, size_t size) { return static_cast<const DmaHeap*>(ctx)->alloc(size); };
+  return a;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Source of capture buffers for V4L2_MEMORY_DMABUF. alloc() returns a dmabuf fd of at least
+// `size` bytes, or -1; the caller owns the fd.
+struct DmabufAllocator {
+  const char* name = nullptr;
+  int (*alloc)(void* ctx, size_t size) = nullptr;
+  void* ctx = nullptr;
+  // Row pitch the importers (GPU, display) want bytesperline aligned to; 0 keeps the driver's.
+  uint32_t pitch_align = 0;
+};
+
+// Allocations from a /dev/dma_heap/* heap. open("") tries linux,cma, then system.
+class DmaHeap {
+public:
+  DmaHeap() = default;
+  DmaHeap(const DmaHeap&) = delete;
+  DmaHeap& operator=(const DmaHeap&) = delete;
+  ~DmaHeap() { close(); }
+
+  bool open(const std::string& path);
+  void close();
+
+  int alloc(size_t size) const;
+  const std::string& path() const { return path_; }
+
+  // Valid while this heap stays open.
+  DmabufAllocator allocator();
+
+private:
+  int fd_ = -1;
+  std::string path_;
+};
@@ -8,9 +8,9 @@
 #include <cstdlib>
 #include <string>
 #include <vector>
-#include <sys/select.h>
-#include <sys/time.h>
 #include <cctype>
+#include <poll.h>
+#include <time.h>
 
 #include <gbm.h>
 #include <xf86drm.h>
@@ -199,6 +199,165 @@ static bool choose_mode(drmModeConnector* conn, drmModeModeInfo& out) {
   return true;
 }
 
+// Looks up a property by name on a KMS object; 0 if it does not exist. `value` receives its
+// current value when non-null.
+static uint32_t find_property(int fd, uint32_t obj_id, uint32_t obj_type, const char* name, uint64_t* value = nullptr) {
+  drmModeObjectProperties* props = drmModeObjectGetProperties(fd, obj_id, obj_type);
+  if (!props) return 0;
+  uint32_t id = 0;
+  for (uint32_t i = 0; i < props->count_props && !id; i++) {
+    drmModePropertyRes* p = drmModeGetProperty(fd, props->props[i]);
+    if (!p) continue;
+    if (std::strcmp(p->name, name) == 0) {
+      id = p->prop_id;
+      if (value) *value = props->prop_values[i];
+    }
+    drmModeFreeProperty(p);
+  }
+  drmModeFreeObjectProperties(props);
+  return id;
+}
+
+// Value of the enum entry `name` of a property; false if it has no such entry.
+static bool find_enum_value(int fd, uint32_t prop_id, const char* name, uint64_t& value) {
+  drmModePropertyRes* p = drmModeGetProperty(fd, prop_id);
+  if (!p) return false;
+  bool found = false;
+  for (int i = 0; i < p->count_enums && !found; i++) {
+    if (std::strcmp(p->enums[i].name, name) == 0) {
+      value = p->enums[i].value;
+      found = true;
+    }
+  }
+  drmModeFreeProperty(p);
+  return found;
+}
+
+// False if the plane lacks a property every commit needs.
+static bool find_plane_props(int fd, uint32_t plane_id, PlaneProps& p) {
+  p.fb_id = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "FB_ID");
+  p.crtc_id = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_ID");
+  p.src_x = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_X");
+  p.src_y = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_Y");
+  p.src_w = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_W");
+  p.src_h = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_H");
+  p.crtc_x = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_X");
+  p.crtc_y = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_Y");
+  p.crtc_w = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_W");
+  p.crtc_h = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_H");
+  p.in_fence_fd = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "IN_FENCE_FD");
+  p.color_encoding = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "COLOR_ENCODING");
+  p.color_range = find_property(fd, plane_id, DRM_MODE_OBJECT_PLANE, "COLOR_RANGE");
+  return p.fb_id && p.crtc_id && p.src_x && p.src_y && p.src_w && p.src_h && p.crtc_x && p.crtc_y && p.crtc_w && p.crtc_h;
+}
+
+// Adds a plane's full state to a commit: `fb_id` (src_w x src_h) scaled to the whole mode.
+// fb_id 0 turns the plane off.
+static bool add_plane_state(drmModeAtomicReq* req, const GbmEglDrm& ctx, uint32_t plane_id, const PlaneProps& p,
+                            uint32_t fb_id, uint32_t src_w, uint32_t src_h) {
+  bool ok = true;
+  auto add = [&](uint32_t prop, uint64_t value) { ok = ok && drmModeAtomicAddProperty(req, plane_id, prop, value) >= 0; };
+  add(p.fb_id, fb_id);
+  add(p.crtc_id, fb_id ? ctx.crtc_id : 0);
+  if (!fb_id) return ok;
+  // Source rectangle in 16.16 fixed point.
+  add(p.src_x, 0);
+  add(p.src_y, 0);
+  add(p.src_w, (uint64_t)src_w << 16);
+  add(p.src_h, (uint64_t)src_h << 16);
+  add(p.crtc_x, 0);
+  add(p.crtc_y, 0);
+  add(p.crtc_w, ctx.mode_hdisplay);
+  add(p.crtc_h, ctx.mode_vdisplay);
+  return ok;
+}
+
+// Connector, mode and ACTIVE for the first commit (DRM_MODE_ATOMIC_ALLOW_MODESET).
+static bool add_modeset_state(drmModeAtomicReq* req, const GbmEglDrm& ctx) {
+  const AtomicProps& p = ctx.props;
+  return drmModeAtomicAddProperty(req, ctx.connector_id, p.conn_crtc_id, ctx.crtc_id) >= 0 &&
+         drmModeAtomicAddProperty(req, ctx.crtc_id, p.crtc_mode_id, ctx.mode_blob_id) >= 0 &&
+         drmModeAtomicAddProperty(req, ctx.crtc_id, p.crtc_active, 1) >= 0 &&
+         (!ctx.vrr || drmModeAtomicAddProperty(req, ctx.crtc_id, p.crtc_vrr_enabled, 1) >= 0);
+}
+
+// Enables atomic modesetting and finds the CRTC's primary plane and every property a commit
+// needs. False leaves the context on the legacy path.
+static bool init_atomic(GbmEglDrm& ctx, drmModeRes* res) {
+  if (drmSetClientCap(ctx.drm_fd, DRM_CLIENT_CAP_ATOMIC, 1) != 0) {
+    std::fprintf(stderr, "[drm_gbm_egl] atomic KMS not supported by the driver, using legacy page flips\n");
+    return false;
+  }
+
+  int crtc_index = -1;
+  for (int i = 0; i < res->count_crtcs; i++) {
+    if (res->crtcs[i] == ctx.crtc_id) crtc_index = i;
+  }
+  ctx.crtc_index = crtc_index;
+  drmModePlaneRes* planes = drmModeGetPlaneResources(ctx.drm_fd);
+  if (crtc_index < 0 || !planes) {
+    if (planes) drmModeFreePlaneResources(planes);
+    std::fprintf(stderr, "[drm_gbm_egl] atomic KMS: no plane resources, using legacy page flips\n");
+    return false;
+  }
+  ctx.plane_id = 0;
+  for (uint32_t i = 0; i < planes->count_planes && !ctx.plane_id; i++) {
+    drmModePlane* plane = drmModeGetPlane(ctx.drm_fd, planes->planes[i]);
+    if (!plane) continue;
+    uint64_t type = 0;
+    if ((plane->possible_crtcs & (1u << crtc_index)) &&
+        find_property(ctx.drm_fd, plane->plane_id, DRM_MODE_OBJECT_PLANE, "type", &type) && type == DRM_PLANE_TYPE_PRIMARY) {
+      ctx.plane_id = plane->plane_id;
+    }
+    drmModeFreePlane(plane);
+  }
+  drmModeFreePlaneResources(planes);
+  if (!ctx.plane_id) {
+    std::fprintf(stderr, "[drm_gbm_egl] atomic KMS: no primary plane for CRTC %u, using legacy page flips\n", ctx.crtc_id);
+    return false;
+  }
+
+  AtomicProps& p = ctx.props;
+  const int fd = ctx.drm_fd;
+  p.conn_crtc_id = find_property(fd, ctx.connector_id, DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID");
+  p.crtc_mode_id = find_property(fd, ctx.crtc_id, DRM_MODE_OBJECT_CRTC, "MODE_ID");
+  p.crtc_active = find_property(fd, ctx.crtc_id, DRM_MODE_OBJECT_CRTC, "ACTIVE");
+  p.crtc_out_fence_ptr = find_property(fd, ctx.crtc_id, DRM_MODE_OBJECT_CRTC, "OUT_FENCE_PTR");
+  if (!p.conn_crtc_id || !p.crtc_mode_id || !p.crtc_active || !find_plane_props(fd, ctx.plane_id, p.primary)) {
+    std::fprintf(stderr, "[drm_gbm_egl] atomic KMS: required properties missing, using legacy page flips\n");
+    return false;
+  }
+  if (ctx.vrr_requested) {
+    uint64_t capable = 0;
+    const bool has_capable = find_property(fd, ctx.connector_id, DRM_MODE_OBJECT_CONNECTOR, "vrr_capable", &capable) != 0;
+    p.crtc_vrr_enabled = find_property(fd, ctx.crtc_id, DRM_MODE_OBJECT_CRTC, "VRR_ENABLED");
+    ctx.vrr = has_capable && capable && p.crtc_vrr_enabled;
+    if (!ctx.vrr) {
+      std::fprintf(stderr, "[drm_gbm_egl] VRR: %s, using fixed refresh\n",
+                   !has_capable || !capable ? "connector/panel is not vrr_capable" : "CRTC has no VRR_ENABLED");
+    }
+  }
+  if (drmModeCreatePropertyBlob(fd, &ctx.mode, sizeof(ctx.mode), &ctx.mode_blob_id) != 0) {
+    std::fprintf(stderr, "[drm_gbm_egl] atomic KMS: mode blob failed: %s, using legacy page flips\n", std::strerror(errno));
+    return false;
+  }
+  if (ctx.debug) {
+    std::fprintf(stderr, "[drm_gbm_egl] atomic KMS: plane=%u in_fence=%d out_fence=%d\n", ctx.plane_id,
+                 p.primary.in_fence_fd ? 1 : 0, p.crtc_out_fence_ptr ? 1 : 0);
+  }
+  return true;
+}
+
+// EGL_ANDROID_native_fence_sync turns the GPU work of a frame into a sync_file for IN_FENCE_FD.
+static bool init_native_fences(GbmEglDrm& ctx) {
+  const char* ext = eglQueryString(ctx.egl_display, EGL_EXTENSIONS);
+  if (!ext || !std::strstr(ext, "EGL_ANDROID_native_fence_sync") || !std::strstr(ext, "EGL_KHR_fence_sync")) return false;
+  ctx.egl_create_sync = (PFNEGLCREATESYNCKHRPROC)eglGetProcAddress("eglCreateSyncKHR");
+  ctx.egl_destroy_sync = (PFNEGLDESTROYSYNCKHRPROC)eglGetProcAddress("eglDestroySyncKHR");
+  ctx.egl_dup_native_fence_fd = (PFNEGLDUPNATIVEFENCEFDANDROIDPROC)eglGetProcAddress("eglDupNativeFenceFDANDROID");
+  return ctx.egl_create_sync && ctx.egl_destroy_sync && ctx.egl_dup_native_fence_fd;
+}
+
 static bool init_egl_display_and_context(GbmEglDrm& ctx) {
   ctx.egl_display = eglGetDisplay((EGLNativeDisplayType)ctx.gbm_dev);
   if (ctx.egl_display == EGL_NO_DISPLAY) {
@@ -300,6 +459,11 @@ bool init_drm_gbm_egl(GbmEglDrm& ctx, const char* drm_node, const char* mode_ove
     std::fprintf(stderr, "[drm_gbm_egl] open(%s) failed: %s\n", drm_node, std::strerror(errno));
     return false;
   }
+  uint64_t ts_monotonic = 0;
+  ctx.flip_ts_monotonic = drmGetCap(ctx.drm_fd, DRM_CAP_TIMESTAMP_MONOTONIC, &ts_monotonic) == 0 && ts_monotonic != 0;
+  if (!ctx.flip_ts_monotonic) {
+    std::fprintf(stderr, "[drm_gbm_egl] page-flip timestamps are not CLOCK_MONOTONIC; latency is measured at event handling\n");
+  }
 
   if (ctx.debug) {
     std::fprintf(stderr, "[drm_gbm_egl] drmModeGetResources...\n");
@@ -373,6 +537,7 @@ bool init_drm_gbm_egl(GbmEglDrm& ctx, const char* drm_node, const char* mode_ove
   ctx.mode_hdisplay = mode.hdisplay;
   ctx.mode_vdisplay = mode.vdisplay;
   ctx.mode = mode;
+  ctx.atomic = ctx.atomic_requested && init_atomic(ctx, res);
 
   drmModeFreeEncoder(enc);
   drmModeFreeConnector(conn);
@@ -398,6 +563,11 @@ bool init_drm_gbm_egl(GbmEglDrm& ctx, const char* drm_node, const char* mode_ove
     std::fflush(stderr);
   }
   if (!create_gbm_and_egl_surface(ctx)) return false;
+  ctx.in_fences = ctx.atomic && ctx.props.primary.in_fence_fd && init_native_fences(ctx);
+  if (ctx.atomic) {
+    std::fprintf(stderr, "[drm_gbm_egl] atomic KMS on plane %u (%s%s)\n", ctx.plane_id,
+                 ctx.in_fences ? "GPU fence as IN_FENCE_FD" : "implicit GPU sync", ctx.vrr ? ", VRR" : "");
+  }
 
   if (ctx.debug) {
     std::fprintf(stderr, "[drm_gbm_egl] init done\n");
@@ -414,15 +584,24 @@ bool drm_gbm_egl_make_current(GbmEglDrm& ctx) {
   return true;
 }
 
-static void page_flip_handler(int fd, unsigned int frame, unsigned int sec, unsigned int usec, void* data) {
-  (void)fd;
-  (void)frame;
-  (void)sec;
-  (void)usec;
-  auto* ctx = static_cast<GbmEglDrm*>(data);
-  if (!ctx) return;
+static uint64_t monotonic_now_ns() {
+  timespec now{};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+// The pending flip is on screen: its buffer becomes the scanout buffer and the one before it
+// goes back to GBM.
+static void complete_flip(GbmEglDrm* ctx, unsigned int frame, uint64_t flip_ns) {
   ctx->pageflip_pending = false;
   ctx->pageflip_completed++;
+  if (ctx->out_fence_fd >= 0) close(ctx->out_fence_fd);
+  ctx->out_fence_fd = -1;
+
+  ctx->last_flip_ns = flip_ns;
+  ctx->last_flip_vblank = frame;
+  ctx->last_flip_tag = ctx->pending_flip_tag;
+  ctx->pending_flip_tag = FlipTag{};
 
   if (ctx->gbm_surf && ctx->prev_bo) {
     gbm_surface_release_buffer(ctx->gbm_surf, ctx->prev_bo);
@@ -432,85 +611,89 @@ static void page_flip_handler(int fd, unsigned int frame, unsigned int sec, unsi
   ctx->cur_bo = nullptr;
 }
 
-static void drain_drm_events(GbmEglDrm& ctx) {
-  drmEventContext ev{};
-  std::memset(&ev, 0, sizeof(ev));
-  ev.version = DRM_EVENT_CONTEXT_VERSION;
-  ev.page_flip_handler = page_flip_handler;
-
-  while (ctx.pageflip_pending) {
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(ctx.drm_fd, &fds);
-    timeval tv{};
-    tv.tv_sec = 0;
-    tv.tv_usec = 0;
-    int r = select(ctx.drm_fd + 1, &fds, nullptr, nullptr, &tv);
-    if (r < 0) {
-      if (errno == EINTR) continue;
-      break;
-    }
-    if (r == 0) break;
-    drmHandleEvent(ctx.drm_fd, &ev);
+static void page_flip_handler(int fd, unsigned int frame, unsigned int sec, unsigned int usec, void* data) {
+  (void)fd;
+  auto* ctx = static_cast<GbmEglDrm*>(data);
+  if (!ctx) return;
+  // Events arrive in commit order, so a late one belongs to a flip already completed from
+  // its out-fence.
+  if (ctx->late_events > 0) {
+    ctx->late_events--;
+    return;
   }
+  const uint64_t ns = ctx->flip_ts_monotonic ? (uint64_t)sec * 1000000000ull + (uint64_t)usec * 1000ull : monotonic_now_ns();
+  complete_flip(ctx, frame, ns);
 }
 
-static void wait_pageflip(GbmEglDrm& ctx, int timeout_ms) {
-  if (!ctx.pageflip_pending) return;
-
+bool drm_gbm_egl_handle_events(GbmEglDrm& ctx) {
   drmEventContext ev{};
   std::memset(&ev, 0, sizeof(ev));
   ev.version = DRM_EVENT_CONTEXT_VERSION;
   ev.page_flip_handler = page_flip_handler;
+  if (drmHandleEvent(ctx.drm_fd, &ev) != 0) {
+    if (errno == EAGAIN || errno == EINTR) return true;
+    std::fprintf(stderr, "[drm_gbm_egl] drmHandleEvent failed: %s\n", std::strerror(errno));
+    return false;
+  }
+  return true;
+}
 
-  fd_set fds;
-  FD_ZERO(&fds);
-  FD_SET(ctx.drm_fd, &fds);
-
-  timeval tv{};
-  tv.tv_sec = timeout_ms / 1000;
-  tv.tv_usec = (timeout_ms % 1000) * 1000;
-
-  int remaining = timeout_ms;
-  while (ctx.pageflip_pending && remaining > 0) {
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(ctx.drm_fd, &rfds);
-
-    timeval rtv{};
-    rtv.tv_sec = remaining / 1000;
-    rtv.tv_usec = (remaining % 1000) * 1000;
-
-    int r = select(ctx.drm_fd + 1, &rfds, nullptr, nullptr, &rtv);
-    if (r < 0) {
-      if (errno == EINTR) continue;
-      break;
+void drm_gbm_egl_pageflip_timeout(GbmEglDrm& ctx) {
+  if (!ctx.pageflip_pending) return;
+  ctx.pageflip_timeouts++;
+  if (ctx.atomic) {
+    // A nonblocking atomic commit always completes; its out-fence says whether it already has.
+    // If so only the event is late: complete the flip now (timestamped now) and ignore the
+    // event when it comes. If not, the display is still busy and the flip stays pending.
+    pollfd pfd{};
+    pfd.fd = ctx.out_fence_fd;
+    pfd.events = POLLIN;
+    if (ctx.out_fence_fd >= 0 && poll(&pfd, 1, 0) > 0) {
+      if (ctx.debug) std::fprintf(stderr, "[drm_gbm_egl] flip event late but out-fence signalled, completing flip\n");
+      ctx.late_events++;
+      complete_flip(&ctx, ctx.last_flip_vblank + 1, monotonic_now_ns());
+    } else if (ctx.debug) {
+      std::fprintf(stderr, "[drm_gbm_egl] atomic commit still pending\n");
     }
-    if (r == 0) break;
-    drmHandleEvent(ctx.drm_fd, &ev);
-    break;
+    return;
+  }
+  // If the event doesn't arrive, skipping causes a static frame. Switch to modeset fallback
+  // immediately to keep live output.
+  if (ctx.debug) {
+    std::fprintf(stderr, "[drm_gbm_egl] pageflip pending too long, switching to drmModeSetCrtc fallback\n");
+  }
+  ctx.pageflip_enabled = false;
+  ctx.pageflip_pending = false;
+  ctx.pageflip_dropped = 0;
+  if (ctx.gbm_surf && ctx.prev_bo) {
+    gbm_surface_release_buffer(ctx.gbm_surf, ctx.prev_bo);
+    ctx.prev_bo = nullptr;
+  }
+  if (ctx.gbm_surf && ctx.prev_bo2) {
+    gbm_surface_release_buffer(ctx.gbm_surf, ctx.prev_bo2);
+    ctx.prev_bo2 = nullptr;
+  }
+  if (ctx.gbm_surf && ctx.cur_bo) {
+    gbm_surface_release_buffer(ctx.gbm_surf, ctx.cur_bo);
+    ctx.cur_bo = nullptr;
   }
+}
 
-  if (ctx.pageflip_pending) {
-    ctx.pageflip_timeouts++;
-    if (ctx.pageflip_timeouts > 10) {
-      if (ctx.debug) {
-        std::fprintf(stderr, "[drm_gbm_egl] pageflip stuck, resetting (timeouts=%u)\n", ctx.pageflip_timeouts);
-      }
-      ctx.pageflip_pending = false;
-      ctx.pageflip_timeouts = 0;
-      ctx.pageflip_enabled = false;
-      if (ctx.gbm_surf && ctx.prev_bo) {
-        gbm_surface_release_buffer(ctx.gbm_surf, ctx.prev_bo);
-        ctx.prev_bo = nullptr;
-      }
-    }
-  } else {
-    ctx.pageflip_timeouts = 0;
+uint64_t drm_gbm_egl_frame_period_ns(const GbmEglDrm& ctx) {
+  const drmModeModeInfo& m = ctx.mode;
+  // The pixel clock gives the exact period (59.94 vs 60); vrefresh is rounded.
+  if (m.clock && m.htotal && m.vtotal) {
+    uint64_t ns = (uint64_t)m.htotal * m.vtotal * 1000000ull / m.clock;
+    if (m.flags & DRM_MODE_FLAG_INTERLACE) ns /= 2;
+    if (m.flags & DRM_MODE_FLAG_DBLSCAN) ns *= 2;
+    if (ns) return ns;
   }
+  if (m.vrefresh) return 1000000000ull / m.vrefresh;
+  return 1000000000ull / 60;
 }
 
-static bool drm_set_crtc_for_bo(GbmEglDrm& ctx, gbm_bo* bo, uint32_t& fb_id_inout) {
+// The framebuffer for a GBM buffer, created on first use and kept with the buffer.
+static bool fb_for_bo(GbmEglDrm& ctx, gbm_bo* bo, uint32_t& fb_id_out) {
   struct FbData {
     int drm_fd;
     uint32_t fb_id;
@@ -550,7 +733,12 @@ static bool drm_set_crtc_for_bo(GbmEglDrm& ctx, gbm_bo* bo, uint32_t& fb_id_inou
     gbm_bo_set_user_data(bo, fb, destroy_fb);
   }
 
-  fb_id_inout = fb->fb_id;
+  fb_id_out = fb->fb_id;
+  return true;
+}
+
+static bool drm_set_crtc_for_bo(GbmEglDrm& ctx, gbm_bo* bo, uint32_t& fb_id_inout) {
+  if (!fb_for_bo(ctx, bo, fb_id_inout)) return false;
 
   if (!ctx.modeset_done) {
     int set_ret = drmModeSetCrtc(ctx.drm_fd, ctx.crtc_id, fb_id_inout, 0, 0, &ctx.connector_id, 1, &ctx.mode);
@@ -564,40 +752,118 @@ static bool drm_set_crtc_for_bo(GbmEglDrm& ctx, gbm_bo* bo, uint32_t& fb_id_inou
   return true;
 }
 
-bool drm_gbm_egl_swap_buffers(GbmEglDrm& ctx) {
-  drain_drm_events(ctx);
-
-  if (ctx.pageflip_enabled && ctx.pageflip_pending) {
-    wait_pageflip(ctx, 16);
-    if (ctx.pageflip_pending) {
-      // If the event doesn't arrive, skipping causes a static frame. Switch to modeset fallback
-      // immediately to keep live output.
-      if (ctx.debug) {
-        std::fprintf(stderr, "[drm_gbm_egl] pageflip pending too long, switching to drmModeSetCrtc fallback\n");
-      }
-      ctx.pageflip_enabled = false;
-      ctx.pageflip_pending = false;
-      ctx.pageflip_timeouts = 0;
-      ctx.pageflip_dropped = 0;
-      if (ctx.gbm_surf && ctx.prev_bo) {
-        gbm_surface_release_buffer(ctx.gbm_surf, ctx.prev_bo);
-        ctx.prev_bo = nullptr;
-      }
-      if (ctx.gbm_surf && ctx.prev_bo2) {
-        gbm_surface_release_buffer(ctx.gbm_surf, ctx.prev_bo2);
-        ctx.prev_bo2 = nullptr;
-      }
-      if (ctx.gbm_surf && ctx.cur_bo) {
-        gbm_surface_release_buffer(ctx.gbm_surf, ctx.cur_bo);
-        ctx.cur_bo = nullptr;
-      }
+enum class AtomicResult { Done, Failed, Fallback };
+
+// Presents `bo` with one atomic commit. The first commit sets the mode (blocking); later ones
+// are nonblocking page flips that complete through the usual flip event. Takes ownership of
+// in_fence_fd. Fallback: the modeset was refused, the context is now legacy and bo untouched.
+static AtomicResult atomic_present(GbmEglDrm& ctx, gbm_bo* bo, const FlipTag& tag, int in_fence_fd) {
+  auto give_up = [&](AtomicResult r) {
+    if (in_fence_fd >= 0) close(in_fence_fd);
+    if (r != AtomicResult::Fallback) gbm_surface_release_buffer(ctx.gbm_surf, bo);
+    return r;
+  };
+
+  uint32_t fb_id = 0;
+  if (!fb_for_bo(ctx, bo, fb_id)) return give_up(AtomicResult::Failed);
+  if (ctx.pageflip_pending) {
+    // The caller presents too early; the loop normally waits for the flip event first.
+    ctx.pageflip_dropped++;
+    return give_up(AtomicResult::Done);
+  }
+
+  const AtomicProps& p = ctx.props;
+  const bool modeset = !ctx.modeset_done;
+  drmModeAtomicReq* req = drmModeAtomicAlloc();
+  if (!req) return give_up(AtomicResult::Failed);
+  int32_t out_fence = -1;
+  bool ok = true;
+  auto add = [&](uint32_t obj, uint32_t prop, uint64_t value) { ok = ok && drmModeAtomicAddProperty(req, obj, prop, value) >= 0; };
+  if (modeset) ok = add_modeset_state(req, ctx);
+  if (modeset || ctx.primary_dirty) {
+    ok = ok && add_plane_state(req, ctx, ctx.plane_id, p.primary, fb_id, gbm_bo_get_width(bo), gbm_bo_get_height(bo));
+  } else {
+    add(ctx.plane_id, p.primary.fb_id, fb_id);
+  }
+  if (in_fence_fd >= 0) add(ctx.plane_id, p.primary.in_fence_fd, (uint64_t)in_fence_fd);
+  if (!modeset && p.crtc_out_fence_ptr) add(ctx.crtc_id, p.crtc_out_fence_ptr, (uint64_t)(uintptr_t)&out_fence);
+
+  const uint32_t flags = modeset ? DRM_MODE_ATOMIC_ALLOW_MODESET : (DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT);
+  const int ret = ok ? drmModeAtomicCommit(ctx.drm_fd, req, flags, &ctx) : -1;
+  drmModeAtomicFree(req);
+  // The commit holds its own reference to the fence.
+  if (in_fence_fd >= 0) close(in_fence_fd);
+  in_fence_fd = -1;
+
+  if (ret != 0) {
+    if (modeset && ctx.vrr) {
+      // Some drivers advertise VRR but refuse it for this mode; keep atomic at a fixed rate.
+      std::fprintf(stderr, "[drm_gbm_egl] atomic modeset with VRR failed: %s, retrying at fixed refresh\n",
+                   std::strerror(errno));
+      ctx.vrr = false;
+      return atomic_present(ctx, bo, tag, -1);
     }
+    if (modeset) {
+      std::fprintf(stderr, "[drm_gbm_egl] atomic modeset failed: %s, using legacy page flips\n", std::strerror(errno));
+      ctx.atomic = false;
+      ctx.in_fences = false;
+      return AtomicResult::Fallback;
+    }
+    if (errno == EBUSY) {
+      if (ctx.debug) std::fprintf(stderr, "[drm_gbm_egl] atomic commit EBUSY, dropping frame\n");
+      ctx.pageflip_dropped++;
+      return give_up(AtomicResult::Done);
+    }
+    std::fprintf(stderr, "[drm_gbm_egl] atomic commit failed: %s\n", std::strerror(errno));
+    return give_up(AtomicResult::Failed);
+  }
+
+  ctx.primary_dirty = false;
+  if (modeset) {
+    ctx.modeset_done = true;
+    if (ctx.prev_bo) gbm_surface_release_buffer(ctx.gbm_surf, ctx.prev_bo);
+    ctx.prev_bo = bo;
+    return AtomicResult::Done;
   }
+  ctx.cur_bo = bo;
+  ctx.pageflip_pending = true;
+  ctx.pending_flip_tag = tag;
+  if (ctx.out_fence_fd >= 0) close(ctx.out_fence_fd);
+  ctx.out_fence_fd = out_fence;
+  ctx.pageflip_submitted++;
+  return AtomicResult::Done;
+}
 
+bool drm_gbm_egl_swap_buffers(GbmEglDrm& ctx) {
+  const FlipTag tag = ctx.next_flip_tag;
+  ctx.next_flip_tag = FlipTag{};
+
+  // Fence the frame's GPU work before the swap flushes it; the commit waits on the fence in
+  // the kernel instead of this thread waiting on the GPU.
+  EGLSyncKHR gpu_sync = EGL_NO_SYNC_KHR;
+  if (ctx.in_fences && ctx.modeset_done) {
+    const EGLint attr[] = {EGL_SYNC_NATIVE_FENCE_FD_ANDROID, EGL_NO_NATIVE_FENCE_FD_ANDROID, EGL_NONE};
+    gpu_sync = ctx.egl_create_sync(ctx.egl_display, EGL_SYNC_NATIVE_FENCE_ANDROID, attr);
+  }
   eglSwapBuffers(ctx.egl_display, ctx.egl_surface);
+  int in_fence_fd = -1;
+  if (gpu_sync != EGL_NO_SYNC_KHR) {
+    in_fence_fd = ctx.egl_dup_native_fence_fd(ctx.egl_display, gpu_sync);
+    ctx.egl_destroy_sync(ctx.egl_display, gpu_sync);
+  }
 
   gbm_bo* bo = gbm_surface_lock_front_buffer(ctx.gbm_surf);
-  if (!bo) return false;
+  if (!bo) {
+    if (in_fence_fd >= 0) close(in_fence_fd);
+    return false;
+  }
+
+  if (ctx.atomic) {
+    const AtomicResult r = atomic_present(ctx, bo, tag, in_fence_fd);
+    if (r != AtomicResult::Fallback) return r == AtomicResult::Done;
+  } else if (in_fence_fd >= 0) {
+    close(in_fence_fd);
+  }
 
   bool was_modeset = ctx.modeset_done;
 
@@ -672,20 +938,7 @@ bool drm_gbm_egl_swap_buffers(GbmEglDrm& ctx) {
   }
 
   if (ctx.pageflip_pending) {
-    wait_pageflip(ctx, 16);
-    if (!ctx.pageflip_pending) {
-      ctx.cur_bo = bo;
-      ctx.pageflip_pending = true;
-      int ret2 = drmModePageFlip(ctx.drm_fd, ctx.crtc_id, fb_id, DRM_MODE_PAGE_FLIP_EVENT, &ctx);
-      if (ret2) {
-        ctx.pageflip_pending = false;
-        std::fprintf(stderr, "[drm_gbm_egl] drmModePageFlip failed: %s\n", std::strerror(errno));
-        gbm_surface_release_buffer(ctx.gbm_surf, bo);
-        return false;
-      }
-      ctx.pageflip_submitted++;
-      return true;
-    }
+    // The caller presents too early; the loop normally waits for the flip event first.
     ctx.pageflip_dropped++;
     gbm_surface_release_buffer(ctx.gbm_surf, bo);
     return true;
@@ -693,9 +946,11 @@ bool drm_gbm_egl_swap_buffers(GbmEglDrm& ctx) {
 
   ctx.cur_bo = bo;
   ctx.pageflip_pending = true;
+  ctx.pending_flip_tag = tag;
   int ret = drmModePageFlip(ctx.drm_fd, ctx.crtc_id, fb_id, DRM_MODE_PAGE_FLIP_EVENT, &ctx);
   if (ret) {
     ctx.pageflip_pending = false;
+    ctx.pending_flip_tag = FlipTag{};
     std::fprintf(stderr, "[drm_gbm_egl] drmModePageFlip failed: %s\n", std::strerror(errno));
     gbm_surface_release_buffer(ctx.gbm_surf, bo);
     return false;
@@ -706,7 +961,253 @@ bool drm_gbm_egl_swap_buffers(GbmEglDrm& ctx) {
   return true;
 }
 
+static int gbm_dmabuf_alloc(void* data, size_t size) {
+  auto* ctx = static_cast<GbmEglDrm*>(data);
+  if (!ctx || !ctx->gbm_dev || size == 0) return -1;
+  // An R8 surface is just bytes; keep it within typical 2D size limits.
+  uint32_t width = 4096;
+  while (width < 16384 && (size + width - 1) / width > 8192) width *= 2;
+  const uint32_t height = (uint32_t)((size + width - 1) / width);
+  gbm_bo* bo = gbm_bo_create(ctx->gbm_dev, width, height, GBM_FORMAT_R8, GBM_BO_USE_LINEAR | GBM_BO_USE_RENDERING);
+  if (!bo) {
+    std::fprintf(stderr, "[drm_gbm_egl] gbm_bo_create(R8 %ux%u) failed: %s\n", width, height, std::strerror(errno));
+    return -1;
+  }
+  // The dmabuf keeps the memory alive once the BO handle is gone.
+  const int fd = gbm_bo_get_fd(bo);
+  if (fd >= 0 && (size_t)gbm_bo_get_stride(bo) * height < size) {
+    std::fprintf(stderr, "[drm_gbm_egl] GBM buffer smaller than requested %zu bytes\n", size);
+    ::close(fd);
+    gbm_bo_destroy(bo);
+    return -1;
+  }
+  gbm_bo_destroy(bo);
+  return fd;
+}
+
+uint32_t drm_gbm_egl_pitch_alignment(GbmEglDrm& ctx) {
+  if (!ctx.gbm_dev) return 0;
+  gbm_bo* bo = gbm_bo_create(ctx.gbm_dev, 1, 1, GBM_FORMAT_R8, GBM_BO_USE_LINEAR | GBM_BO_USE_RENDERING);
+  if (!bo) return 0;
+  uint32_t align = gbm_bo_get_stride(bo);
+  gbm_bo_destroy(bo);
+  // Round to a power of two so it can be used as an alignment.
+  uint32_t p2 = 1;
+  while (p2 < align && p2 < 4096) p2 <<= 1;
+  return p2;
+}
+
+bool drm_gbm_egl_dmabuf_formats(GbmEglDrm& ctx, std::vector<uint32_t>& formats) {
+  formats.clear();
+  auto query = (PFNEGLQUERYDMABUFFORMATSEXTPROC)eglGetProcAddress("eglQueryDmaBufFormatsEXT");
+  if (!query || ctx.egl_display == EGL_NO_DISPLAY) return false;
+  EGLint n = 0;
+  if (!query(ctx.egl_display, 0, nullptr, &n) || n <= 0) return false;
+  std::vector<EGLint> list((size_t)n);
+  if (!query(ctx.egl_display, n, list.data(), &n)) return false;
+  for (EGLint i = 0; i < n; i++) formats.push_back((uint32_t)list[(size_t)i]);
+  return true;
+}
+
+DmabufAllocator drm_gbm_egl_dmabuf_allocator(GbmEglDrm& ctx) {
+  DmabufAllocator a;
+  a.name = "gbm";
+  a.ctx = &ctx;
+  a.alloc = gbm_dmabuf_alloc;
+  a.pitch_align = drm_gbm_egl_pitch_alignment(ctx);
+  return a;
+}
+
+uint32_t drm_gbm_egl_add_dmabuf_fb(GbmEglDrm& ctx, uint32_t width, uint32_t height, uint32_t format, const int* fds,
+                                   const uint32_t* offsets, const uint32_t* pitches, int nplanes) {
+  uint32_t handles[4] = {};
+  uint32_t fb_pitches[4] = {};
+  uint32_t fb_offsets[4] = {};
+  bool ok = nplanes > 0 && nplanes <= 4;
+  for (int i = 0; ok && i < nplanes; i++) {
+    ok = drmPrimeFDToHandle(ctx.drm_fd, fds[i], &handles[i]) == 0;
+    fb_pitches[i] = pitches[i];
+    fb_offsets[i] = offsets[i];
+  }
+  uint32_t fb_id = 0;
+  if (ok && drmModeAddFB2(ctx.drm_fd, width, height, format, handles, fb_pitches, fb_offsets, &fb_id, 0) != 0) {
+    if (ctx.debug) std::fprintf(stderr, "[drm_gbm_egl] drmModeAddFB2(0x%08x %ux%u) failed: %s\n", format, width, height, std::strerror(errno));
+    fb_id = 0;
+  }
+  // The framebuffer holds its own references. Planes of one buffer share a handle, so close
+  // each distinct handle once.
+  for (int i = 0; i < nplanes && i < 4; i++) {
+    bool seen = handles[i] == 0;
+    for (int j = 0; j < i && !seen; j++) seen = handles[j] == handles[i];
+    if (!seen) drmCloseBufferHandle(ctx.drm_fd, handles[i]);
+  }
+  return fb_id;
+}
+
+void drm_gbm_egl_remove_fb(GbmEglDrm& ctx, uint32_t fb_id) {
+  if (fb_id && ctx.drm_fd >= 0) drmModeRmFB(ctx.drm_fd, fb_id);
+}
+
+// The whole state of the scanout plane, plus the primary plane turned off when the scanout
+// plane is an overlay (so GL output does not show through or cost bandwidth).
+static bool add_scanout_state(drmModeAtomicReq* req, const GbmEglDrm& ctx, uint32_t fb_id) {
+  const PlaneProps& sp = ctx.scanout_props;
+  bool ok = add_plane_state(req, ctx, ctx.scanout_plane_id, sp, fb_id, ctx.scanout_src_w, ctx.scanout_src_h);
+  if (sp.color_encoding) ok = ok && drmModeAtomicAddProperty(req, ctx.scanout_plane_id, sp.color_encoding, ctx.scanout_encoding) >= 0;
+  if (sp.color_range) ok = ok && drmModeAtomicAddProperty(req, ctx.scanout_plane_id, sp.color_range, ctx.scanout_range) >= 0;
+  if (ctx.scanout_plane_id != ctx.plane_id) ok = ok && add_plane_state(req, ctx, ctx.plane_id, ctx.props.primary, 0, 0, 0);
+  return ok;
+}
+
+static bool plane_has_format(const drmModePlane* plane, uint32_t format) {
+  for (uint32_t i = 0; i < plane->count_formats; i++) {
+    if (plane->formats[i] == format) return true;
+  }
+  return false;
+}
+
+bool drm_gbm_egl_scanout_begin(GbmEglDrm& ctx, uint32_t format, uint32_t fb_id, uint32_t src_w, uint32_t src_h,
+                               Colorimetry c) {
+  if (!ctx.atomic || ctx.crtc_index < 0 || !fb_id) return false;
+  drmModePlaneRes* planes = drmModeGetPlaneResources(ctx.drm_fd);
+  if (!planes) return false;
+
+  // Overlays first: video planes usually are, and the primary stays free for GL fallback.
+  // Cursor planes are never candidates.
+  std::vector<uint32_t> candidates;
+  for (uint64_t want : {(uint64_t)DRM_PLANE_TYPE_OVERLAY, (uint64_t)DRM_PLANE_TYPE_PRIMARY}) {
+    for (uint32_t i = 0; i < planes->count_planes; i++) {
+      drmModePlane* plane = drmModeGetPlane(ctx.drm_fd, planes->planes[i]);
+      if (!plane) continue;
+      uint64_t type = 0;
+      if ((plane->possible_crtcs & (1u << ctx.crtc_index)) && plane_has_format(plane, format) &&
+          find_property(ctx.drm_fd, plane->plane_id, DRM_MODE_OBJECT_PLANE, "type", &type) && type == want) {
+        candidates.push_back(plane->plane_id);
+      }
+      drmModeFreePlane(plane);
+    }
+  }
+  drmModeFreePlaneResources(planes);
+
+  ctx.scanout_src_w = src_w;
+  ctx.scanout_src_h = src_h;
+  for (uint32_t plane_id : candidates) {
+    PlaneProps props;
+    if (!find_plane_props(ctx.drm_fd, plane_id, props)) continue;
+    ctx.scanout_plane_id = plane_id;
+    ctx.scanout_props = props;
+    static const char* const kEncodings[] = {"ITU-R BT.601 YCbCr", "ITU-R BT.709 YCbCr", "ITU-R BT.2020 YCbCr"};
+    if (props.color_encoding && !find_enum_value(ctx.drm_fd, props.color_encoding, kEncodings[(int)c.matrix], ctx.scanout_encoding)) {
+      ctx.scanout_props.color_encoding = 0;
+    }
+    const char* range = (c.range == YuvRange::Full) ? "YCbCr full range" : "YCbCr limited range";
+    if (props.color_range && !find_enum_value(ctx.drm_fd, props.color_range, range, ctx.scanout_range)) {
+      ctx.scanout_props.color_range = 0;
+    }
+
+    // TEST_ONLY: the plane may still refuse the pitch, the scaling ratio or the bandwidth.
+    drmModeAtomicReq* req = drmModeAtomicAlloc();
+    if (!req) return false;
+    const bool modeset = !ctx.modeset_done;
+    bool ok = (!modeset || add_modeset_state(req, ctx)) && add_scanout_state(req, ctx, fb_id);
+    uint32_t flags = DRM_MODE_ATOMIC_TEST_ONLY;
+    if (modeset) flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+    ok = ok && drmModeAtomicCommit(ctx.drm_fd, req, flags, nullptr) == 0;
+    drmModeAtomicFree(req);
+    if (ok) {
+      ctx.scanout_active = true;
+      return true;
+    }
+    if (ctx.debug) std::fprintf(stderr, "[drm_gbm_egl] plane %u refused format 0x%08x %ux%u: %s\n", plane_id, format, src_w, src_h, std::strerror(errno));
+  }
+  ctx.scanout_plane_id = 0;
+  return false;
+}
+
+bool drm_gbm_egl_scanout_present(GbmEglDrm& ctx, uint32_t fb_id) {
+  const FlipTag tag = ctx.next_flip_tag;
+  ctx.next_flip_tag = FlipTag{};
+  if (!ctx.scanout_active) return false;
+  if (ctx.pageflip_pending) {
+    ctx.pageflip_dropped++;
+    return true;
+  }
+
+  // Every commit carries the whole plane state: it is small, and it keeps the primary plane
+  // off after a GL frame restored it.
+  const bool modeset = !ctx.modeset_done;
+  drmModeAtomicReq* req = drmModeAtomicAlloc();
+  if (!req) return false;
+  int32_t out_fence = -1;
+  bool ok = (!modeset || add_modeset_state(req, ctx)) && add_scanout_state(req, ctx, fb_id);
+  if (ok && !modeset && ctx.props.crtc_out_fence_ptr) {
+    ok = drmModeAtomicAddProperty(req, ctx.crtc_id, ctx.props.crtc_out_fence_ptr, (uint64_t)(uintptr_t)&out_fence) >= 0;
+  }
+  const uint32_t flags = modeset ? DRM_MODE_ATOMIC_ALLOW_MODESET : (DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT);
+  const int ret = ok ? drmModeAtomicCommit(ctx.drm_fd, req, flags, &ctx) : -1;
+  drmModeAtomicFree(req);
+  if (ret != 0) {
+    if (errno == EBUSY && !modeset) {
+      ctx.pageflip_dropped++;
+      return true;
+    }
+    std::fprintf(stderr, "[drm_gbm_egl] scanout commit failed: %s\n", std::strerror(errno));
+    return false;
+  }
+
+  ctx.primary_dirty = true;
+  if (modeset) {
+    ctx.modeset_done = true;
+    return true;
+  }
+  ctx.cur_bo = nullptr;
+  ctx.pageflip_pending = true;
+  ctx.pending_flip_tag = tag;
+  if (ctx.out_fence_fd >= 0) close(ctx.out_fence_fd);
+  ctx.out_fence_fd = out_fence;
+  ctx.pageflip_submitted++;
+  return true;
+}
+
+void drm_gbm_egl_scanout_end(GbmEglDrm& ctx) {
+  if (!ctx.scanout_active) return;
+  ctx.scanout_active = false;
+  // A blocking commit that waits for a pending flip, so no direct flip is in flight once this
+  // returns. An overlay is switched off by it, before its framebuffers are removed. A primary
+  // scanout plane keeps its state (the commit only restates ACTIVE); it is rewritten by the next
+  // GL frame, which does a full modeset, since removing the framebuffer it shows may switch the
+  // CRTC off.
+  const bool primary = ctx.scanout_plane_id == ctx.plane_id;
+  if (ctx.modeset_done) {
+    drmModeAtomicReq* req = drmModeAtomicAlloc();
+    if (req) {
+      const bool ok = primary ? drmModeAtomicAddProperty(req, ctx.crtc_id, ctx.props.crtc_active, 1) >= 0
+                              : add_plane_state(req, ctx, ctx.scanout_plane_id, ctx.scanout_props, 0, 0, 0);
+      if (!ok || drmModeAtomicCommit(ctx.drm_fd, req, 0, nullptr) != 0) {
+        std::fprintf(stderr, "[drm_gbm_egl] ending scanout on plane %u failed: %s\n", ctx.scanout_plane_id, std::strerror(errno));
+      }
+      drmModeAtomicFree(req);
+    }
+  }
+  if (primary) ctx.modeset_done = false;
+  ctx.scanout_plane_id = 0;
+}
+
 void destroy_drm_gbm_egl(GbmEglDrm& ctx) {
+  if (ctx.vrr && ctx.modeset_done && ctx.drm_fd >= 0) {
+    // VRR_ENABLED outlives the client; hand the CRTC back at a fixed rate.
+    drmModeAtomicReq* req = drmModeAtomicAlloc();
+    if (req) {
+      if (drmModeAtomicAddProperty(req, ctx.crtc_id, ctx.props.crtc_vrr_enabled, 0) >= 0) {
+        drmModeAtomicCommit(ctx.drm_fd, req, DRM_MODE_ATOMIC_ALLOW_MODESET, nullptr);
+      }
+      drmModeAtomicFree(req);
+    }
+  }
+  if (ctx.out_fence_fd >= 0) close(ctx.out_fence_fd);
+  ctx.out_fence_fd = -1;
+  if (ctx.mode_blob_id && ctx.drm_fd >= 0) drmModeDestroyPropertyBlob(ctx.drm_fd, ctx.mode_blob_id);
+  ctx.mode_blob_id = 0;
   if (ctx.egl_display != EGL_NO_DISPLAY) {
     eglMakeCurrent(ctx.egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     if (ctx.egl_surface != EGL_NO_SURFACE) eglDestroySurface(ctx.egl_display, ctx.egl_surface);
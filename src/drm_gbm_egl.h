@@ -1,10 +1,47 @@
 #pragma once
 
+#include "colorimetry.h"
+#include "dmabuf_alloc.h"
+
 #include <cstdint>
+#include <vector>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <xf86drmMode.h>
 
+// What a flip puts on screen, so its completion event can be matched to the captured frame.
+struct FlipTag {
+  uint32_t sequence = 0;    // V4L2 buffer sequence number
+  uint64_t capture_ns = 0;  // capture timestamp, CLOCK_MONOTONIC; 0 = untagged
+};
+
+// Property IDs of a KMS plane; 0 where the kernel lacks the property.
+struct PlaneProps {
+  uint32_t fb_id = 0;
+  uint32_t crtc_id = 0;
+  uint32_t src_x = 0;
+  uint32_t src_y = 0;
+  uint32_t src_w = 0;
+  uint32_t src_h = 0;
+  uint32_t crtc_x = 0;
+  uint32_t crtc_y = 0;
+  uint32_t crtc_w = 0;
+  uint32_t crtc_h = 0;
+  uint32_t in_fence_fd = 0;
+  uint32_t color_encoding = 0;
+  uint32_t color_range = 0;
+};
+
+// Property IDs an atomic commit needs; 0 where the kernel lacks the property.
+struct AtomicProps {
+  uint32_t conn_crtc_id = 0;
+  uint32_t crtc_mode_id = 0;
+  uint32_t crtc_active = 0;
+  uint32_t crtc_out_fence_ptr = 0;
+  uint32_t crtc_vrr_enabled = 0;
+  PlaneProps primary;
+};
+
 struct GbmEglDrm {
   int drm_fd = -1;
 
@@ -27,6 +64,52 @@ struct GbmEglDrm {
   uint64_t pageflip_completed = 0;
   uint64_t pageflip_dropped = 0;
 
+  // Set before drm_gbm_egl_swap_buffers(). The tag rides along with an event-driven flip and
+  // becomes last_flip_tag when its event arrives; last_flip_ns/last_flip_vblank are the
+  // event's vblank timestamp (CLOCK_MONOTONIC) and counter. Flips without events drop the tag.
+  FlipTag next_flip_tag;
+  FlipTag pending_flip_tag;
+  FlipTag last_flip_tag;
+  uint64_t last_flip_ns = 0;
+  uint32_t last_flip_vblank = 0;
+  // DRM_CAP_TIMESTAMP_MONOTONIC; otherwise flip times are taken when the event is handled.
+  bool flip_ts_monotonic = false;
+
+  // Atomic KMS: set atomic_requested before init. `atomic` is what is in use; it falls back to
+  // legacy SetCrtc/PageFlip when the driver has no atomic support or the first commit fails.
+  // Commits are nonblocking, take the GPU's render fence as IN_FENCE_FD (no CPU wait for the
+  // GPU) and return an OUT_FENCE_PTR fence that signals once the frame is on screen.
+  bool atomic_requested = false;
+  bool atomic = false;
+  bool in_fences = false;  // EGL_ANDROID_native_fence_sync available
+  int out_fence_fd = -1;   // of the pending commit
+  uint32_t late_events = 0;  // flips completed from their out-fence whose event is still due
+  uint32_t mode_blob_id = 0;
+  int crtc_index = -1;
+  AtomicProps props;
+  // Variable refresh (atomic only): set vrr_requested before init. `vrr` is set when the
+  // connector reports vrr_capable and the CRTC has VRR_ENABLED, and the modeset commit turns it
+  // on. Each flip then starts a refresh as soon as it lands, within the panel's range, so
+  // pageflip timestamps follow the source cadence instead of the mode period.
+  bool vrr_requested = false;
+  bool vrr = false;
+  // Set when something other than GL output owned the primary plane; the next GL frame then
+  // rewrites its whole state instead of just FB_ID.
+  bool primary_dirty = false;
+
+  // Direct scanout of capture buffers (drm_gbm_egl_scanout_*): the plane showing them, its
+  // properties and the source size and colorimetry (COLOR_ENCODING/COLOR_RANGE enum values).
+  uint32_t scanout_plane_id = 0;
+  PlaneProps scanout_props;
+  uint32_t scanout_src_w = 0;
+  uint32_t scanout_src_h = 0;
+  uint64_t scanout_encoding = 0;
+  uint64_t scanout_range = 0;
+  bool scanout_active = false;
+  PFNEGLCREATESYNCKHRPROC egl_create_sync = nullptr;
+  PFNEGLDESTROYSYNCKHRPROC egl_destroy_sync = nullptr;
+  PFNEGLDUPNATIVEFENCEFDANDROIDPROC egl_dup_native_fence_fd = nullptr;
+
   EGLDisplay egl_display = EGL_NO_DISPLAY;
   EGLConfig egl_config = nullptr;
   EGLContext egl_context = EGL_NO_CONTEXT;
@@ -46,5 +129,37 @@ struct GbmEglDrm {
 
 bool init_drm_gbm_egl(GbmEglDrm& ctx, const char* drm_node, const char* mode_override);
 bool drm_gbm_egl_make_current(GbmEglDrm& ctx);
+// Never blocks: with page-flip events enabled, call it only once pageflip_pending is clear.
 bool drm_gbm_egl_swap_buffers(GbmEglDrm& ctx);
+// Dispatches pending DRM events; call when drm_fd is readable.
+bool drm_gbm_egl_handle_events(GbmEglDrm& ctx);
+// The flip event did not arrive in time. Legacy: give up on page flips and present via
+// SetCrtc. Atomic: complete the flip if its out-fence has signalled, otherwise keep it
+// pending (call again later).
+void drm_gbm_egl_pageflip_timeout(GbmEglDrm& ctx);
+// Scanout period of the selected mode.
+uint64_t drm_gbm_egl_frame_period_ns(const GbmEglDrm& ctx);
+// Linear GBM buffers on the display device, for V4L2_MEMORY_DMABUF capture. pitch_align is
+// the smallest stride GBM hands out, i.e. the pitch alignment the GPU/display expect.
+DmabufAllocator drm_gbm_egl_dmabuf_allocator(GbmEglDrm& ctx);
+uint32_t drm_gbm_egl_pitch_alignment(GbmEglDrm& ctx);
+// DRM fourccs EGL can import from dmabufs (eglQueryDmaBufFormatsEXT). False if the query is
+// not available, in which case the caller should assume the common formats work.
+bool drm_gbm_egl_dmabuf_formats(GbmEglDrm& ctx, std::vector<uint32_t>& formats);
+
+// Direct scanout: capture dmabufs shown on a KMS plane without the GPU (atomic KMS only).
+// A framebuffer over a 1-3 plane dmabuf; 0 on failure.
+uint32_t drm_gbm_egl_add_dmabuf_fb(GbmEglDrm& ctx, uint32_t width, uint32_t height, uint32_t format, const int* fds,
+                                   const uint32_t* offsets, const uint32_t* pitches, int nplanes);
+void drm_gbm_egl_remove_fb(GbmEglDrm& ctx, uint32_t fb_id);
+// Picks a plane on the CRTC that takes `format` and test-commits fb_id on it, scaled to the
+// mode, with the colorimetry passed as the plane's COLOR_ENCODING/COLOR_RANGE where it has them.
+// False if no plane accepts it; the caller keeps rendering with GL.
+bool drm_gbm_egl_scanout_begin(GbmEglDrm& ctx, uint32_t format, uint32_t fb_id, uint32_t src_w, uint32_t src_h,
+                               Colorimetry c);
+// Nonblocking flip to fb_id on the scanout plane; completes through the flip event like
+// drm_gbm_egl_swap_buffers() and takes next_flip_tag the same way.
+bool drm_gbm_egl_scanout_present(GbmEglDrm& ctx, uint32_t fb_id);
+// Takes the scanout plane off the screen; the next swap_buffers restores GL output.
+void drm_gbm_egl_scanout_end(GbmEglDrm& ctx);
 void destroy_drm_gbm_egl(GbmEglDrm& ctx);
@@ -0,0 +1,134 @@
+#include "event_loop.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+bool EventLoop::init() {
+  close();
+
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+    std::fprintf(stderr, "[event_loop] pthread_sigmask failed\n");
+    return false;
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  signal_fd_ = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (epoll_fd_ < 0 || signal_fd_ < 0 || timer_fd_ < 0) {
+    std::fprintf(stderr, "[event_loop] epoll/signalfd/timerfd setup failed: %s\n", std::strerror(errno));
+    close();
+    return false;
+  }
+  if (!add_fd(signal_fd_, EPOLLIN, kSignal) || !add_fd(timer_fd_, EPOLLIN, kTimer)) {
+    close();
+    return false;
+  }
+  quit_ = false;
+  return true;
+}
+
+void EventLoop::close() {
+  if (timer_fd_ >= 0) ::close(timer_fd_);
+  if (signal_fd_ >= 0) ::close(signal_fd_);
+  if (epoll_fd_ >= 0) ::close(epoll_fd_);
+  timer_fd_ = -1;
+  signal_fd_ = -1;
+  epoll_fd_ = -1;
+}
+
+bool EventLoop::add_fd(int fd, uint32_t events, uint32_t tag, uint32_t pri_tag) {
+  epoll_event ev{};
+  ev.events = events;
+  ev.data.u64 = ((uint64_t)pri_tag << 32) | tag;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    std::fprintf(stderr, "[event_loop] EPOLL_CTL_ADD fd=%d failed: %s\n", fd, std::strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool EventLoop::watch(int fd, uint32_t src, bool edge_triggered, uint32_t pri_src) {
+  if (epoll_fd_ < 0 || fd < 0) return false;
+  uint32_t events = edge_triggered ? (uint32_t)EPOLLET : 0u;
+  if (src) events |= EPOLLIN;
+  if (pri_src) events |= EPOLLPRI;
+  return add_fd(fd, events, src, pri_src);
+}
+
+bool EventLoop::unwatch(int fd) {
+  if (epoll_fd_ < 0 || fd < 0) return false;
+  return epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) == 0;
+}
+
+bool EventLoop::arm_timer(uint64_t delay_ns, uint64_t interval_ns) {
+  if (timer_fd_ < 0) return false;
+  itimerspec its{};
+  its.it_value.tv_sec = (time_t)(delay_ns / 1000000000ull);
+  its.it_value.tv_nsec = (long)(delay_ns % 1000000000ull);
+  its.it_interval.tv_sec = (time_t)(interval_ns / 1000000000ull);
+  its.it_interval.tv_nsec = (long)(interval_ns % 1000000000ull);
+  return timerfd_settime(timer_fd_, 0, &its, nullptr) == 0;
+}
+
+void EventLoop::handle_signals() {
+  signalfd_siginfo si{};
+  while (::read(signal_fd_, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+    if (quit_) continue;
+    quit_ = true;
+
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_DFL;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    // Only this thread is unblocked; workers keep the mask they inherited, so the kernel
+    // delivers the next signal here.
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
+  }
+}
+
+uint32_t EventLoop::wait(int timeout_ms) {
+  if (epoll_fd_ < 0) return 0;
+
+  epoll_event events[8];
+  int n = epoll_wait(epoll_fd_, events, 8, timeout_ms);
+  if (n < 0) {
+    if (errno != EINTR) std::fprintf(stderr, "[event_loop] epoll_wait failed: %s\n", std::strerror(errno));
+    return 0;
+  }
+
+  uint32_t fired = 0;
+  for (int i = 0; i < n; i++) {
+    const uint32_t tag = (uint32_t)events[i].data.u64;
+    const uint32_t pri_tag = (uint32_t)(events[i].data.u64 >> 32);
+    if (events[i].events & EPOLLPRI) fired |= pri_tag;
+    // Errors are reported to the regular source so its handler sees the failure.
+    if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) fired |= tag ? tag : pri_tag;
+  }
+
+  if (fired & kTimer) {
+    uint64_t expirations = 0;
+    if (::read(timer_fd_, &expirations, sizeof(expirations)) < 0) {
+      // EAGAIN: re-armed between the wakeup and the read.
+      fired &= ~(uint32_t)kTimer;
+    }
+  }
+  if (fired & kSignal) handle_signals();
+  return fired;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+// epoll reactor for the render thread. Besides the fds registered with watch() it owns a
+// signalfd (SIGINT/SIGTERM) and one timerfd, so a single epoll_wait() covers capture,
+// page-flip completion, shutdown and timeouts.
+class EventLoop {
+public:
+  enum Source : uint32_t {
+    kCapture = 1u << 0,
+    kDisplay = 1u << 1,
+    kTimer = 1u << 2,
+    kSignal = 1u << 3,
+    kSourceChange = 1u << 4,
+  };
+
+  EventLoop() = default;
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+  ~EventLoop() { close(); }
+
+  // Blocks SIGINT/SIGTERM in the calling thread and routes them to the signalfd. Call it
+  // before any other thread is spawned so they inherit the mask.
+  bool init();
+  void close();
+
+  // Edge-triggered sources must be drained by the caller every time they are reported.
+  // pri_src, if set, is reported for EPOLLPRI on the same fd (V4L2 events); src may be 0 to
+  // watch EPOLLPRI only.
+  bool watch(int fd, uint32_t src, bool edge_triggered = false, uint32_t pri_src = 0);
+  bool unwatch(int fd);
+
+  // One-shot after delay_ns, then every interval_ns if non-zero. arm_timer(0) disarms.
+  bool arm_timer(uint64_t delay_ns, uint64_t interval_ns = 0);
+
+  // Waits up to timeout_ms (-1 = forever) and returns the Source bits that fired. Timer
+  // expirations and signals are consumed here.
+  uint32_t wait(int timeout_ms);
+
+  // The first SIGINT/SIGTERM requests a clean shutdown and restores the default action, so a
+  // second one terminates the process even if shutdown hangs.
+  bool quit_requested() const { return quit_; }
+
+private:
+  bool add_fd(int fd, uint32_t events, uint32_t tag, uint32_t pri_tag = 0);
+  void handle_signals();
+
+  int epoll_fd_ = -1;
+  int signal_fd_ = -1;
+  int timer_fd_ = -1;
+  bool quit_ = false;
+};
@@ -0,0 +1,114 @@
+#include "format_plan.h"
+
+#include <algorithm>
+#include <linux/videodev2.h>
+
+// Cost model, tuned on a Rock 5B (RK3588, LPDDR4x) and only meant to order candidates:
+//  - the GPU reading a frame it samples in place (~30 GB/s effective),
+//  - glTexSubImage2D copying through the driver (~3 GB/s, CPU-bound),
+//  - the SIMD converters (rock5b_bench_convert reports ~1 ns/pixel on the big cores).
+static constexpr double kGpuSampleNsPerByte = 0.03;
+static constexpr double kUploadNsPerByte = 0.35;
+static constexpr double kConvertNsPerPixel = 1.0;
+
+const std::vector<PlannableFormat>& plannable_formats() {
+  static const std::vector<PlannableFormat> kFormats = {
+      {V4L2_PIX_FMT_NV12, 1},    {V4L2_PIX_FMT_NV12M, 2}, {V4L2_PIX_FMT_YUV420M, 3}, {V4L2_PIX_FMT_NV16, 1},
+      {V4L2_PIX_FMT_NV16M, 2},   {V4L2_PIX_FMT_NV24, 1},  {V4L2_PIX_FMT_YUYV, 1},    {V4L2_PIX_FMT_UYVY, 1},
+      {V4L2_PIX_FMT_BGR24, 1},
+  };
+  return kFormats;
+}
+
+// Bytes the renderer touches per frame, including row padding.
+static double frame_bytes(const FormatCandidate& c) {
+  const double h = (double)c.height;
+  switch (c.fourcc) {
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV12M:
+    case V4L2_PIX_FMT_YUV420M:
+      return (c.bytesperline ? c.bytesperline : c.width) * h * 1.5;
+    case V4L2_PIX_FMT_NV16:
+    case V4L2_PIX_FMT_NV16M:
+      return (c.bytesperline ? c.bytesperline : c.width) * h * 2.0;
+    case V4L2_PIX_FMT_NV24:
+      return (c.bytesperline ? c.bytesperline : c.width) * h * 3.0;
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_UYVY:
+      return (c.bytesperline ? c.bytesperline : c.width * 2) * h;
+    case V4L2_PIX_FMT_BGR24:
+      return (c.bytesperline ? c.bytesperline : c.width * 3) * h;
+    default:
+      return 0.0;
+  }
+}
+
+FormatPlan plan_format(const FormatCandidate& c, const ImportCaps& caps) {
+  FormatPlan plan;
+  plan.format = c;
+
+  const bool aligned = caps.pitch_realigned || caps.pitch_align <= 1 || (c.bytesperline % caps.pitch_align) == 0;
+  bool gpu = false;
+  bool importable = false;
+  switch (c.fourcc) {
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV12M:
+    case V4L2_PIX_FMT_NV16:
+    case V4L2_PIX_FMT_NV16M:
+    case V4L2_PIX_FMT_YUV420M:
+    case V4L2_PIX_FMT_NV24:
+      gpu = true;
+      importable = caps.r8_gr88;
+      break;
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_UYVY:
+      gpu = caps.gpu_yuv422;
+      importable = caps.abgr8888;
+      break;
+    case V4L2_PIX_FMT_BGR24:
+      gpu = caps.gpu_bgr24;
+      importable = caps.bgr888;
+      break;
+    default:
+      return plan;
+  }
+
+  const double bytes = frame_bytes(c);
+  if (gpu && caps.dmabuf && importable && aligned) {
+    plan.path = CapturePath::ZeroCopy;
+    plan.cost_us = bytes * kGpuSampleNsPerByte / 1000.0;
+  } else if (gpu) {
+    plan.path = CapturePath::GpuUpload;
+    plan.cost_us = bytes * (kUploadNsPerByte + kGpuSampleNsPerByte) / 1000.0;
+  } else {
+    const double pixels = (double)c.width * (double)c.height;
+    const double rgb_bytes = pixels * 3.0;
+    plan.path = CapturePath::CpuConvert;
+    plan.cost_us = (pixels * kConvertNsPerPixel + rgb_bytes * (kUploadNsPerByte + kGpuSampleNsPerByte)) / 1000.0;
+  }
+  return plan;
+}
+
+std::vector<FormatPlan> rank_formats(const std::vector<FormatCandidate>& candidates, const ImportCaps& caps) {
+  std::vector<FormatPlan> plans;
+  for (const FormatCandidate& c : candidates) {
+    FormatPlan p = plan_format(c, caps);
+    if (p.path != CapturePath::Unsupported) plans.push_back(p);
+  }
+  // Stable, so equal costs keep the plannable_formats() order.
+  std::stable_sort(plans.begin(), plans.end(), [](const FormatPlan& a, const FormatPlan& b) { return a.cost_us < b.cost_us; });
+  return plans;
+}
+
+const char* capture_path_name(CapturePath p) {
+  switch (p) {
+    case CapturePath::ZeroCopy:
+      return "zero-copy";
+    case CapturePath::GpuUpload:
+      return "gpu-upload";
+    case CapturePath::CpuConvert:
+      return "cpu-convert";
+    default:
+      return "unsupported";
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Capture format negotiation: every pixel format the driver offers is scored by the work the
+// renderer would do per frame, and configure() asks for the cheapest one first.
+enum class CapturePath : uint8_t {
+  ZeroCopy,    // dmabuf -> EGLImage, sampled by the GPU in place
+  GpuUpload,   // glTexSubImage2D of the raw planes, decoded in the shader
+  CpuConvert,  // CPU conversion to RGB24, then upload
+  Unsupported,
+};
+
+// What the render side can do with a capture buffer.
+struct ImportCaps {
+  bool dmabuf = false;  // EGL_EXT_image_dma_buf_import usable and zero-copy not disabled
+  // DRM formats eglQueryDmaBufFormatsEXT reports (all assumed importable if unknown).
+  bool r8_gr88 = true;  // NV12/NV16/NV24 as two single-plane images, YUV420M as three R8
+  bool abgr8888 = true;  // packed 4:2:2 as half-width RGBA
+  bool bgr888 = true;
+  // Importers need bytesperline to be a multiple of this (0 = any).
+  uint32_t pitch_align = 0;
+  // Capture buffers are allocated by us and realigned, so the driver's pitch does not matter.
+  bool pitch_realigned = false;
+  bool gpu_yuv422 = true;
+  bool gpu_bgr24 = true;
+};
+
+// A format as the driver would deliver it (VIDIOC_TRY_FMT result).
+struct FormatCandidate {
+  uint32_t fourcc = 0;
+  uint32_t num_planes = 1;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bytesperline = 0;  // plane 0
+};
+
+struct FormatPlan {
+  FormatCandidate format;
+  CapturePath path = CapturePath::Unsupported;
+  // Estimated render-side cost of one frame in microseconds (see format_plan.cpp for the model).
+  double cost_us = 0.0;
+};
+
+// V4L2 fourccs the renderer handles, with the plane count they are requested with.
+struct PlannableFormat {
+  uint32_t fourcc;
+  uint32_t num_planes;
+};
+const std::vector<PlannableFormat>& plannable_formats();
+
+FormatPlan plan_format(const FormatCandidate& c, const ImportCaps& caps);
+// Cheapest first; Unsupported candidates are dropped.
+std::vector<FormatPlan> rank_formats(const std::vector<FormatCandidate>& candidates, const ImportCaps& caps);
+
+const char* capture_path_name(CapturePath p);
@@ -0,0 +1,56 @@
+#include "frame_pool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+bool FramePool::init(uint32_t count, size_t bytes) {
+  reset();
+  if (count == 0 || count > kMaxSlots || bytes == 0) return false;
+
+  long page = sysconf(_SC_PAGESIZE);
+  if (page <= 0) page = 4096;
+  const size_t alloc = (bytes + (size_t)page - 1) & ~((size_t)page - 1);
+
+  slots_.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    void* p = nullptr;
+    if (posix_memalign(&p, (size_t)page, alloc) != 0) {
+      std::fprintf(stderr, "[frame_pool] failed to allocate %zu bytes\n", alloc);
+      reset();
+      return false;
+    }
+    // Touch every page now so the first frames do not take the page faults.
+    std::memset(p, 0, alloc);
+    slots_.push_back(static_cast<uint8_t*>(p));
+  }
+  bytes_ = bytes;
+  leased_.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+void FramePool::reset() {
+  for (uint8_t* p : slots_) std::free(p);
+  slots_.clear();
+  bytes_ = 0;
+  leased_.store(0, std::memory_order_relaxed);
+}
+
+int FramePool::acquire() {
+  const uint32_t all = (slots_.size() >= 32) ? ~0u : ((1u << slots_.size()) - 1u);
+  uint32_t cur = leased_.load(std::memory_order_relaxed);
+  while (true) {
+    const uint32_t free_bits = ~cur & all;
+    if (free_bits == 0) return -1;
+    const int slot = __builtin_ctz(free_bits);
+    if (leased_.compare_exchange_weak(cur, cur | (1u << slot), std::memory_order_acquire, std::memory_order_relaxed)) {
+      return slot;
+    }
+  }
+}
+
+void FramePool::release(int slot) {
+  if (slot < 0 || (size_t)slot >= slots_.size()) return;
+  leased_.fetch_and(~(1u << slot), std::memory_order_release);
+}
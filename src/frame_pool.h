@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed set of page-aligned frame buffers handed out as leases. Buffers are allocated and
+// pre-faulted once in init(), so acquiring and releasing them never touches the heap.
+// acquire()/release() are lock-free and may be called from different threads.
+class FramePool {
+public:
+  static constexpr uint32_t kMaxSlots = 32;
+
+  FramePool() = default;
+  FramePool(const FramePool&) = delete;
+  FramePool& operator=(const FramePool&) = delete;
+  ~FramePool() { reset(); }
+
+  bool init(uint32_t count, size_t bytes);
+  void reset();
+
+  bool ready() const { return !slots_.empty(); }
+  size_t bytes() const { return bytes_; }
+
+  // Returns a free slot index, or -1 when every buffer is leased.
+  int acquire();
+  void release(int slot);
+  uint8_t* data(int slot) const { return slots_[(size_t)slot]; }
+
+private:
+  std::vector<uint8_t*> slots_;
+  size_t bytes_ = 0;
+  std::atomic_uint32_t leased_{0};
+};
@@ -0,0 +1,66 @@
+#include "gpu_timer.h"
+
+#include <EGL/egl.h>
+#include <cstring>
+
+bool GpuTimer::init() {
+  destroy();
+  const char* ext = (const char*)glGetString(GL_EXTENSIONS);
+  if (!ext || !std::strstr(ext, "GL_EXT_disjoint_timer_query")) return false;
+
+  gen_queries_ = (PFNGLGENQUERIESEXTPROC)eglGetProcAddress("glGenQueriesEXT");
+  delete_queries_ = (PFNGLDELETEQUERIESEXTPROC)eglGetProcAddress("glDeleteQueriesEXT");
+  begin_query_ = (PFNGLBEGINQUERYEXTPROC)eglGetProcAddress("glBeginQueryEXT");
+  end_query_ = (PFNGLENDQUERYEXTPROC)eglGetProcAddress("glEndQueryEXT");
+  get_query_uiv_ = (PFNGLGETQUERYOBJECTUIVEXTPROC)eglGetProcAddress("glGetQueryObjectuivEXT");
+  get_query_ui64v_ = (PFNGLGETQUERYOBJECTUI64VEXTPROC)eglGetProcAddress("glGetQueryObjectui64vEXT");
+  if (!gen_queries_ || !delete_queries_ || !begin_query_ || !end_query_ || !get_query_uiv_ || !get_query_ui64v_) return false;
+
+  gen_queries_(kSlots, ids_);
+  // Clear any disjoint flag left from context creation.
+  GLint disjoint = 0;
+  glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+  ready_ = true;
+  return true;
+}
+
+void GpuTimer::destroy() {
+  if (ready_) delete_queries_(kSlots, ids_);
+  std::memset(ids_, 0, sizeof(ids_));
+  std::memset(pending_, 0, sizeof(pending_));
+  head_ = 0;
+  tail_ = 0;
+  active_ = false;
+  ready_ = false;
+}
+
+void GpuTimer::begin() {
+  // All slots still in flight: skip this frame rather than wait.
+  if (!ready_ || active_ || pending_[head_]) return;
+  begin_query_(GL_TIME_ELAPSED_EXT, ids_[head_]);
+  active_ = true;
+}
+
+void GpuTimer::end() {
+  if (!active_) return;
+  end_query_(GL_TIME_ELAPSED_EXT);
+  pending_[head_] = true;
+  head_ = (head_ + 1) % kSlots;
+  active_ = false;
+}
+
+void GpuTimer::collect(LatencyHistogram& h) {
+  if (!ready_) return;
+  while (pending_[tail_]) {
+    GLuint available = 0;
+    get_query_uiv_(ids_[tail_], GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+    if (!available) break;
+    GLuint64 ns = 0;
+    get_query_ui64v_(ids_[tail_], GL_QUERY_RESULT_EXT, &ns);
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if (!disjoint) h.observe_ns((uint64_t)ns);
+    pending_[tail_] = false;
+    tail_ = (tail_ + 1) % kSlots;
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+// GPU duration of a span of GL commands via GL_EXT_disjoint_timer_query. Queries are read
+// back a few frames later, only once their result is available, so the render loop never
+// stalls on them. Without the extension every call is a no-op.
+class GpuTimer {
+public:
+  // Needs a current context. False (and inert) if the extension is missing.
+  bool init();
+  void destroy();
+
+  void begin();
+  void end();
+  // Moves every finished measurement into `h`. Results from a disjoint period (GPU clock
+  // change, context loss) are discarded.
+  void collect(LatencyHistogram& h);
+
+private:
+  static constexpr int kSlots = 4;
+
+  PFNGLGENQUERIESEXTPROC gen_queries_ = nullptr;
+  PFNGLDELETEQUERIESEXTPROC delete_queries_ = nullptr;
+  PFNGLBEGINQUERYEXTPROC begin_query_ = nullptr;
+  PFNGLENDQUERYEXTPROC end_query_ = nullptr;
+  PFNGLGETQUERYOBJECTUIVEXTPROC get_query_uiv_ = nullptr;
+  PFNGLGETQUERYOBJECTUI64VEXTPROC get_query_ui64v_ = nullptr;
+
+  GLuint ids_[kSlots] = {};
+  bool pending_[kSlots] = {};
+  int head_ = 0;  // next slot to begin
+  int tail_ = 0;  // oldest slot not yet collected
+  bool active_ = false;
+  bool ready_ = false;
+};
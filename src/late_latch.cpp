@@ -0,0 +1,59 @@
+#include "late_latch.h"
+
+void LateLatch::reset(uint64_t frame_period_ns) {
+  period_ns_ = frame_period_ns;
+  last_vblank_ns_ = 0;
+  planned_vblank_ns_ = 0;
+  target_vblank_ns_ = 0;
+  begin_ns_ = 0;
+  cost_peak_ns_ = 0;
+  margin_ns_ = kInitialMarginNs;
+  misses_ = 0;
+}
+
+void LateLatch::on_flip(uint64_t vblank_ns) {
+  if (vblank_ns != 0 && target_vblank_ns_ != 0) {
+    if (vblank_ns > target_vblank_ns_ + period_ns_ / 2) {
+      misses_++;
+      margin_ns_ += kMissStepNs;
+      if (margin_ns_ > period_ns_ / 2) margin_ns_ = period_ns_ / 2;
+    } else if (margin_ns_ > kMinMarginNs + kHitStepNs) {
+      margin_ns_ -= kHitStepNs;
+    } else {
+      margin_ns_ = kMinMarginNs;
+    }
+  }
+  target_vblank_ns_ = 0;
+  last_vblank_ns_ = vblank_ns;
+}
+
+uint64_t LateLatch::start_time(uint64_t now_ns) {
+  planned_vblank_ns_ = 0;
+  if (period_ns_ == 0 || last_vblank_ns_ == 0 || last_vblank_ns_ > now_ns) return now_ns;
+  const uint64_t budget = cost_peak_ns_ + margin_ns_;
+  // Too slow to latch at all: render as soon as possible.
+  if (budget >= period_ns_) return now_ns;
+
+  uint64_t vblank = last_vblank_ns_ + period_ns_;
+  if (vblank <= now_ns) vblank += ((now_ns - vblank) / period_ns_ + 1) * period_ns_;
+  // Past this vblank's latch point the frame would go out a refresh later anyway, and a
+  // fresher one may arrive by the next latch point.
+  if (vblank - budget < now_ns) vblank += period_ns_;
+  planned_vblank_ns_ = vblank;
+  return vblank - budget;
+}
+
+void LateLatch::begin(uint64_t now_ns) {
+  begin_ns_ = now_ns;
+  target_vblank_ns_ = planned_vblank_ns_;
+  planned_vblank_ns_ = 0;
+}
+
+void LateLatch::end(uint64_t now_ns) {
+  if (begin_ns_ == 0 || now_ns < begin_ns_) return;
+  const uint64_t cost = now_ns - begin_ns_;
+  begin_ns_ = 0;
+  // Decaying peak: follows a slower frame at once, a faster run over a few dozen frames.
+  cost_peak_ns_ -= cost_peak_ns_ / 32;
+  if (cost > cost_peak_ns_) cost_peak_ns_ = cost;
+}
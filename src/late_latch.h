@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// Schedules acquire+render as late as possible before the vblank it is meant for, so the
+// newest captured frame goes out each refresh instead of whichever one was ready right after
+// the previous flip. The next vblank is predicted from page-flip timestamps and the mode's
+// period. The budget before it is the render cost (a decaying peak of acquire-to-submit
+// times) plus a safety margin: a flip that lands a vblank late widens the margin, and every
+// on-time flip narrows it a little.
+//
+// Single-threaded; all times are CLOCK_MONOTONIC.
+class LateLatch {
+public:
+  static constexpr uint64_t kInitialMarginNs = 2000000;
+  static constexpr uint64_t kMinMarginNs = 500000;
+  static constexpr uint64_t kMissStepNs = 1000000;
+  static constexpr uint64_t kHitStepNs = 20000;
+
+  void reset(uint64_t frame_period_ns);
+
+  // A flip completed at vblank_ns. Forget the prediction (vblank_ns 0) after a mode or
+  // presentation change.
+  void on_flip(uint64_t vblank_ns);
+
+  // When to start acquire+render. <= now_ns means start now, e.g. while no vblank has been seen.
+  uint64_t start_time(uint64_t now_ns);
+  // Brackets one acquire+render+submit.
+  void begin(uint64_t now_ns);
+  void end(uint64_t now_ns);
+
+  uint64_t cost_ns() const { return cost_peak_ns_; }
+  uint64_t margin_ns() const { return margin_ns_; }
+  uint64_t misses() const { return misses_; }
+
+private:
+  uint64_t period_ns_ = 0;
+  uint64_t last_vblank_ns_ = 0;
+  uint64_t planned_vblank_ns_ = 0;  // from the last start_time()
+  uint64_t target_vblank_ns_ = 0;   // of the frame in flight
+  uint64_t begin_ns_ = 0;
+  uint64_t cost_peak_ns_ = 0;
+  uint64_t margin_ns_ = kInitialMarginNs;
+  uint64_t misses_ = 0;
+};
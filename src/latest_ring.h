@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded lock-free queue for one producer thread and one consumer thread, where the producer
+// may also drop the oldest entry (discard_oldest()) when the consumer falls behind. The
+// consumer's pop() and the producer's discard_oldest() both claim the tail with a CAS.
+//
+// A claim copies the entry before its CAS. A winning claim read a slot that could not be
+// refilled meanwhile, as the tail stayed put; a losing one throws its copy away and retries.
+// push() also keeps one slot free (it fails at Capacity - 1 entries), so the slot a claim has
+// just lost is never the next one written.
+// Capacity is a power of two; T is copied in and out, so keep it trivially copyable.
+template <typename T, size_t Capacity>
+class LatestRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+  // Producer only.
+  bool push(const T& v) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= Capacity - 1) return false;
+    slots_[head & (Capacity - 1)] = v;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only.
+  bool pop(T& out) { return claim(out); }
+
+  // Producer only: takes the oldest entry so its resources can be released.
+  bool discard_oldest(T& out) { return claim(out); }
+
+  // Producer only; exact there, since nothing can be added concurrently.
+  size_t size() const { return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire); }
+
+  // Only meaningful while neither side is running (e.g. after the producer thread joined).
+  void clear() {
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  bool claim(T& out) {
+    size_t tail = tail_.load(std::memory_order_acquire);
+    while (true) {
+      if (tail == head_.load(std::memory_order_acquire)) return false;
+      out = slots_[tail & (Capacity - 1)];
+      if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_acquire)) return true;
+    }
+  }
+
+  // Producer and consumer indices on separate cache lines.
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) T slots_[Capacity];
+};
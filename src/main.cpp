@@ -1,6 +1,12 @@
 #include "drm_gbm_egl.h"
 #include "v4l2_capture.h"
-#include "shader_utils.h"
+#include "pixel_convert.h"
+#include "alloc_counter.h"
+#include "event_loop.h"
+#include "gpu_timer.h"
+#include "late_latch.h"
+#include "program_cache.h"
+#include "metrics.h"
 
 #include <GLES2/gl2.h>
  #include <GLES2/gl2ext.h>
@@ -13,31 +19,17 @@
 #include <fstream>
 #include <sstream>
 #include <cctype>
+#include <algorithm>
 #include <unordered_map>
+#include <future>
+#include <thread>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <pwd.h>
-#include <csignal>
 #include <time.h>
  #include <EGL/eglext.h>
  #include <drm_fourcc.h>
-
-static volatile sig_atomic_t g_running = 1;
-static volatile sig_atomic_t g_sigint_count = 0;
-
-static void on_sigalrm(int) {
-  std::_Exit(130);
-}
-
-static void on_sigint(int) {
-  g_sigint_count++;
-  g_running = 0;
-  if (g_sigint_count >= 2) {
-    std::_Exit(130);
-  }
-
-  alarm(1);
-}
+#include <linux/videodev2.h>
 
 static std::string read_text_file(const std::string& path) {
   std::ifstream f(path);
@@ -76,28 +68,61 @@ static std::string load_shader(const std::string& shader_dir, const std::string&
   return load_shader_from_dir(shader_dir, name_or_path.c_str());
 }
 
-int main(int argc, char** argv) {
-  {
-    struct sigaction sa;
-    std::memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = on_sigint;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGINT, &sa, nullptr);
+// DRM format a KMS plane must scan out to show a capture buffer as is; 0 if there is none.
+static uint32_t direct_scanout_format(uint32_t v4l2_fourcc, bool uv_swap) {
+  switch (v4l2_fourcc) {
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV12M:
+      return uv_swap ? DRM_FORMAT_NV21 : DRM_FORMAT_NV12;
+    case V4L2_PIX_FMT_NV16:
+    case V4L2_PIX_FMT_NV16M:
+      return uv_swap ? DRM_FORMAT_NV61 : DRM_FORMAT_NV16;
+    case V4L2_PIX_FMT_NV24:
+      return uv_swap ? DRM_FORMAT_NV42 : DRM_FORMAT_NV24;
+    case V4L2_PIX_FMT_YUV420M:
+      return uv_swap ? DRM_FORMAT_YVU420 : DRM_FORMAT_YUV420;
+    default:
+      return 0;
   }
+}
 
-  {
-    struct sigaction sa;
-    std::memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = on_sigalrm;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGALRM, &sa, nullptr);
+static uint64_t monotonic_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Capture-to-scanout latency over some span of displayed frames.
+struct LatencyStats {
+  uint64_t count = 0;
+  uint64_t sum_ns = 0;
+  uint64_t min_ns = 0;
+  uint64_t max_ns = 0;
+
+  void add(uint64_t ns) {
+    if (count == 0 || ns < min_ns) min_ns = ns;
+    if (ns > max_ns) max_ns = ns;
+    sum_ns += ns;
+    count++;
   }
+  double avg_ms() const { return count ? (double)sum_ns / (double)count / 1e6 : 0.0; }
+};
+
+int main(int argc, char** argv) {
+  const uint64_t startup_t0_ns = monotonic_ns();
+  // Before anything spawns threads: SIGINT/SIGTERM are blocked everywhere and read from the
+  // loop's signalfd instead.
+  EventLoop loop;
+  if (!loop.init()) return 1;
 
   std::string video_dev = "/dev/video0";
   std::string drm_dev = "/dev/dri/card0";
   std::string mode_override;
+  std::string capture_memory = "mmap";
+  std::string dma_heap_path;
+  std::string frame_policy = "latest";
+  std::string metrics_file;
+  uint32_t metrics_interval_ms = 1000;
   uint32_t cap_w = 0;
   uint32_t cap_h = 0;
 
@@ -120,7 +145,18 @@ int main(int argc, char** argv) {
   bool flip_y = false;
   bool dmabuf_uv_ra = false;
   bool enable_subpixel = false;
+  bool gpu_yuv422 = true;
+  bool gpu_bgr24 = true;
+  bool capture_thread = false;
+  bool yuv_external = false;
+  bool adaptive_buffers = false;
+  bool program_cache = true;
+  bool atomic_kms = false;
+  bool direct_scanout = false;
+  bool late_latch = false;
+  bool vrr = false;
   uint32_t buffers = 4;
+  uint32_t convert_threads = 0;
 
   int sub_mx = 4;
   int sub_my = 4;
@@ -223,15 +259,35 @@ int main(int argc, char** argv) {
     out << "atlas_flip_y=1\n\n";
     out << "# Optional pipeline toggles (0/1)\n";
     out << "# nv21=0\n";
-    out << "# dmabuf_uv_ra=0\n\n";
+    out << "# dmabuf_uv_ra=0\n";
+    out << "# gpu_yuv422=1\n";
+    out << "# gpu_bgr24=1\n";
+    out << "# capture_thread=0\n";
+    out << "# yuv_external=0\n";
+    out << "# adaptive_buffers=0\n";
+    out << "# program_cache=1\n";
+    out << "# atomic_kms=0\n";
+    out << "# direct_scanout=0\n";
+    out << "# late_latch=0\n";
+    out << "# vrr=0\n\n";
     out << "# Optional shader path override\n";
     out << "# By default, shader_dir is auto-detected as <exe_dir>/../shaders\n";
     out << "# shader_dir=/path/to/shaders\n\n";
     out << "# Optional V4L2 capture buffers (VIDIOC_REQBUFS)\n";
     out << "# buffers=4\n\n";
+    out << "# Optional CPU conversion threads for BGR24/YUYV/UYVY (0=auto, 1=off)\n";
+    out << "# convert_threads=0\n\n";
     out << "# Optional devices (uncomment to pin)\n";
     out << "# video_dev=/dev/video0\n";
     out << "# drm_dev=/dev/dri/card0\n\n";
+    out << "# Optional capture buffer memory: mmap (driver), dma-heap or gbm (imported dmabufs)\n";
+    out << "# capture_memory=mmap\n";
+    out << "# dma_heap=/dev/dma_heap/linux,cma\n\n";
+    out << "# Which captured frame to show when several are ready: latest, fifo or paced\n";
+    out << "# frame_policy=latest\n\n";
+    out << "# Optional Prometheus text file with latency histograms and frame/flip counters\n";
+    out << "# metrics_file=/var/lib/node_exporter/textfile/rock5b_hdmiin_gl.prom\n";
+    out << "# metrics_interval_ms=1000\n\n";
     out << "# Optional DRM mode override (examples: 1920x1080 or 1920x1080@60)\n";
     out << "# mode=1920x1080@60\n";
   };
@@ -257,6 +313,16 @@ int main(int argc, char** argv) {
         {"nv21", &nv21},
         {"dmabuf_uv_ra", &dmabuf_uv_ra},
         {"subpixel", &enable_subpixel},
+        {"gpu_yuv422", &gpu_yuv422},
+        {"gpu_bgr24", &gpu_bgr24},
+        {"capture_thread", &capture_thread},
+        {"yuv_external", &yuv_external},
+        {"adaptive_buffers", &adaptive_buffers},
+        {"program_cache", &program_cache},
+        {"atomic_kms", &atomic_kms},
+        {"direct_scanout", &direct_scanout},
+        {"late_latch", &late_latch},
+        {"vrr", &vrr},
     };
 
     std::string line;
@@ -283,6 +349,26 @@ int main(int argc, char** argv) {
         mode_override = val;
         continue;
       }
+      if (key == "capture_memory") {
+        capture_memory = val;
+        continue;
+      }
+      if (key == "dma_heap") {
+        dma_heap_path = val;
+        continue;
+      }
+      if (key == "frame_policy") {
+        frame_policy = val;
+        continue;
+      }
+      if (key == "metrics_file") {
+        metrics_file = val;
+        continue;
+      }
+      if (key == "metrics_interval_ms") {
+        metrics_interval_ms = (uint32_t)std::strtoul(val.c_str(), nullptr, 10);
+        continue;
+      }
       if (key == "shader_dir") {
         shader_dir = val;
         continue;
@@ -291,6 +377,10 @@ int main(int argc, char** argv) {
         buffers = (uint32_t)std::strtoul(val.c_str(), nullptr, 10);
         continue;
       }
+      if (key == "convert_threads") {
+        convert_threads = (uint32_t)std::strtoul(val.c_str(), nullptr, 10);
+        continue;
+      }
 
       auto itb = mb.find(key);
       if (itb != mb.end()) {
@@ -328,6 +418,16 @@ int main(int argc, char** argv) {
         {"nv21", &nv21},
         {"dmabuf_uv_ra", &dmabuf_uv_ra},
         {"subpixel", &enable_subpixel},
+        {"gpu_yuv422", &gpu_yuv422},
+        {"gpu_bgr24", &gpu_bgr24},
+        {"capture_thread", &capture_thread},
+        {"yuv_external", &yuv_external},
+        {"adaptive_buffers", &adaptive_buffers},
+        {"program_cache", &program_cache},
+        {"atomic_kms", &atomic_kms},
+        {"direct_scanout", &direct_scanout},
+        {"late_latch", &late_latch},
+        {"vrr", &vrr},
     };
     std::string line;
     while (std::getline(f, line)) {
@@ -340,6 +440,10 @@ int main(int argc, char** argv) {
       std::string val = line.substr(eq + 1);
       trim_in_place(key);
       trim_in_place(val);
+      if (key == "frame_policy") {
+        frame_policy = val;
+        continue;
+      }
       auto itb = mb.find(key);
       if (itb != mb.end()) {
         const int v = std::atoi(val.c_str());
@@ -461,6 +565,26 @@ int main(int argc, char** argv) {
       dmabuf_uv_ra = true;
     } else if (std::string(argv[i]) == "--subpixel") {
       enable_subpixel = true;
+    } else if (std::string(argv[i]) == "--no-gpu-yuv422") {
+      gpu_yuv422 = false;
+    } else if (std::string(argv[i]) == "--no-gpu-bgr24") {
+      gpu_bgr24 = false;
+    } else if (std::string(argv[i]) == "--capture-thread") {
+      capture_thread = true;
+    } else if (std::string(argv[i]) == "--yuv-external") {
+      yuv_external = true;
+    } else if (std::string(argv[i]) == "--adaptive-buffers") {
+      adaptive_buffers = true;
+    } else if (std::string(argv[i]) == "--no-program-cache") {
+      program_cache = false;
+    } else if (std::string(argv[i]) == "--atomic-kms") {
+      atomic_kms = true;
+    } else if (std::string(argv[i]) == "--direct-scanout") {
+      direct_scanout = true;
+    } else if (std::string(argv[i]) == "--late-latch") {
+      late_latch = true;
+    } else if (std::string(argv[i]) == "--vrr") {
+      vrr = true;
     } else if (std::string(argv[i]) == "--mx" && (i + 1) < argc) {
       sub_mx = std::atoi(argv[++i]);
     } else if (std::string(argv[i]) == "--my" && (i + 1) < argc) {
@@ -484,6 +608,18 @@ int main(int argc, char** argv) {
       sub_atlas_flip_y = std::atoi(argv[++i]);
     } else if (std::string(argv[i]) == "--buffers" && (i + 1) < argc) {
       buffers = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::string(argv[i]) == "--convert-threads" && (i + 1) < argc) {
+      convert_threads = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::string(argv[i]) == "--metrics-file" && (i + 1) < argc) {
+      metrics_file = argv[++i];
+    } else if (std::string(argv[i]) == "--metrics-interval-ms" && (i + 1) < argc) {
+      metrics_interval_ms = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::string(argv[i]) == "--frame-policy" && (i + 1) < argc) {
+      frame_policy = argv[++i];
+    } else if (std::string(argv[i]) == "--capture-memory" && (i + 1) < argc) {
+      capture_memory = argv[++i];
+    } else if (std::string(argv[i]) == "--dma-heap" && (i + 1) < argc) {
+      dma_heap_path = argv[++i];
     } else if (std::string(argv[i]) == "--w" && (i + 1) < argc) {
       cap_w = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
     } else if (std::string(argv[i]) == "--h" && (i + 1) < argc) {
@@ -491,18 +627,84 @@ int main(int argc, char** argv) {
     }
   }
 
+  V4L2Capture cap;
+  cap.set_debug(debug);
+  cap.set_nv12_uv_swap(nv21);
+  cap.set_request_buffer_count(buffers);
+  cap.set_convert_threads(convert_threads);
+  cap.set_gpu_yuv422(gpu_yuv422);
+  cap.set_gpu_bgr24(gpu_bgr24);
+  cap.set_capture_thread(capture_thread);
+  cap.set_adaptive_depth(adaptive_buffers);
+  FramePolicy policy = FramePolicy::Latest;
+  if (!parse_frame_policy(frame_policy, policy)) {
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] unknown frame_policy '%s' (latest|fifo|paced), using latest\n", frame_policy.c_str());
+  }
+  cap.set_frame_policy(policy);
+
+  // V4L2 bring-up runs on its own thread while DRM/EGL initialises. Opening the device
+  // (DV timings, format enumeration) needs nothing from the display; format negotiation
+  // waits for the import caps and allocator, which come from EGL. The thread owns `cap`
+  // until it is joined below.
+  std::promise<bool> gfx_ready;
+  std::future<bool> gfx_ready_future = gfx_ready.get_future();
+  int cap_init_rc = 0;
+  uint64_t cap_open_ns = 0;
+  uint64_t cap_configure_ns = 0;
+  uint64_t cap_start_ns = 0;
+  std::fprintf(stderr, "[rock5b_hdmiin_gl] open V4L2 device %s\n", video_dev.c_str());
+  std::thread cap_init_thread([&]() {
+    uint64_t t = monotonic_ns();
+    if (!cap.open_device(video_dev)) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] open_device failed: %s\n", std::strerror(errno));
+      cap_init_rc = 2;
+      return;
+    }
+    cap_open_ns = monotonic_ns() - t;
+    if (!gfx_ready_future.get()) return;
+    t = monotonic_ns();
+    if (!cap.configure(cap_w, cap_h)) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] configure failed (requested %ux%u)\n", cap_w, cap_h);
+      cap_init_rc = 3;
+      return;
+    }
+    cap_configure_ns = monotonic_ns() - t;
+    if (debug) std::fprintf(stderr, "[rock5b_hdmiin_gl] V4L2 dmabuf_export_supported=%d\n", cap.dmabuf_export_supported() ? 1 : 0);
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] V4L2 configured: %ux%u fourcc=0x%08x\n", cap.width(), cap.height(), cap.fourcc());
+    t = monotonic_ns();
+    if (!cap.start()) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] start capture failed\n");
+      cap_init_rc = 4;
+      return;
+    }
+    cap_start_ns = monotonic_ns() - t;
+  });
+  auto join_capture_init = [&]() -> int {
+    if (cap_init_thread.joinable()) cap_init_thread.join();
+    return cap_init_rc;
+  };
+
+  const uint64_t gfx_start_ns = monotonic_ns();
   GbmEglDrm gfx{};
   gfx.debug = debug;
+  // Direct scanout drives planes through atomic commits, and VRR_ENABLED is an atomic property.
+  gfx.atomic_requested = atomic_kms || direct_scanout || vrr;
+  gfx.vrr_requested = vrr;
   std::fprintf(stderr, "[rock5b_hdmiin_gl] init DRM/GBM/EGL on %s\n", drm_dev.c_str());
   const char* mode_override_c = mode_override.empty() ? nullptr : mode_override.c_str();
   if (!init_drm_gbm_egl(gfx, drm_dev.c_str(), mode_override_c)) {
     std::fprintf(stderr, "[rock5b_hdmiin_gl] init_drm_gbm_egl failed\n");
+    gfx_ready.set_value(false);
+    join_capture_init();
     return 1;
   }
   if (!drm_gbm_egl_make_current(gfx)) {
     std::fprintf(stderr, "[rock5b_hdmiin_gl] eglMakeCurrent failed\n");
+    gfx_ready.set_value(false);
+    join_capture_init();
     return 1;
   }
+  const uint64_t gfx_ready_ns = monotonic_ns();
 
   const char* egl_ext = eglQueryString(gfx.egl_display, EGL_EXTENSIONS);
   bool egl_has_dmabuf_import = false;
@@ -511,35 +713,37 @@ int main(int argc, char** argv) {
     egl_has_dmabuf_import = (std::strstr(egl_ext, "EGL_EXT_image_dma_buf_import") != nullptr);
   }
 
-  V4L2Capture cap;
-  cap.set_debug(debug);
-  cap.set_nv12_uv_swap(nv21);
-  cap.set_request_buffer_count(buffers);
-  std::fprintf(stderr, "[rock5b_hdmiin_gl] open V4L2 device %s\n", video_dev.c_str());
-  if (!cap.open_device(video_dev)) {
-    std::fprintf(stderr, "[rock5b_hdmiin_gl] open_device failed: %s\n", std::strerror(errno));
-    return 2;
-  }
-  if (!cap.configure(cap_w, cap_h)) {
-    std::fprintf(stderr, "[rock5b_hdmiin_gl] configure failed (requested %ux%u)\n", cap_w, cap_h);
-    return 3;
-  }
-  if (debug) std::fprintf(stderr, "[rock5b_hdmiin_gl] V4L2 dmabuf_export_supported=%d\n", cap.dmabuf_export_supported() ? 1 : 0);
-  std::fprintf(stderr, "[rock5b_hdmiin_gl] V4L2 configured: %ux%u fourcc=0x%08x\n", cap.width(), cap.height(), cap.fourcc());
-  if (!cap.start()) {
-    std::fprintf(stderr, "[rock5b_hdmiin_gl] start capture failed\n");
-    return 4;
+  // Capture into buffers we allocate (V4L2_MEMORY_DMABUF) so their layout suits the GPU and
+  // display; the driver's own MMAP buffers remain the default and the fallback.
+  DmaHeap dma_heap;
+  if (capture_memory == "dma-heap") {
+    if (dma_heap.open(dma_heap_path)) {
+      DmabufAllocator a = dma_heap.allocator();
+      a.pitch_align = drm_gbm_egl_pitch_alignment(gfx);
+      cap.set_dmabuf_allocator(a);
+    }
+  } else if (capture_memory == "gbm") {
+    cap.set_dmabuf_allocator(drm_gbm_egl_dmabuf_allocator(gfx));
+  } else if (capture_memory != "mmap") {
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] unknown capture_memory '%s' (mmap|dma-heap|gbm), using mmap\n", capture_memory.c_str());
   }
 
-  bool use_nv12 = (cap.fourcc() == 0x3231564e) || (cap.fourcc() == 0x32314d4e);
-  bool use_nv24 = (cap.fourcc() == 0x3432564e);
-  bool use_yuv = use_nv12 || use_nv24;
-  bool use_zero_copy = false;
-  if (use_yuv && egl_has_dmabuf_import && cap.dmabuf_export_supported()) {
-    use_zero_copy = true;
-    if (debug) std::fprintf(stderr, "[rock5b_hdmiin_gl] zero-copy path enabled (DMABUF + EGLImage)\n");
+  // Tell format negotiation what the renderer can import, so it can rank the offered formats.
+  ImportCaps import_caps;
+  import_caps.dmabuf = egl_has_dmabuf_import && !disable_zero_copy;
+  std::vector<uint32_t> egl_formats;
+  if (import_caps.dmabuf && drm_gbm_egl_dmabuf_formats(gfx, egl_formats)) {
+    auto has = [&](uint32_t f) { return std::find(egl_formats.begin(), egl_formats.end(), f) != egl_formats.end(); };
+    import_caps.r8_gr88 = has(DRM_FORMAT_R8) && has(DRM_FORMAT_GR88);
+    import_caps.abgr8888 = has(DRM_FORMAT_ABGR8888);
+    import_caps.bgr888 = has(DRM_FORMAT_BGR888);
   }
-  if (disable_zero_copy) use_zero_copy = false;
+  import_caps.pitch_align = drm_gbm_egl_pitch_alignment(gfx);
+  cap.set_import_caps(import_caps);
+  // Hands `cap` back to the V4L2 thread for configure and start; the shaders below build
+  // meanwhile.
+  gfx_ready.set_value(true);
+  if (debug) std::fprintf(stderr, "[rock5b_hdmiin_gl] CPU conversion kernels: %s\n", convert_kernels().name);
 
   if (shader_dir.empty()) {
     const std::string exe_dir = get_exe_dir();
@@ -547,15 +751,6 @@ int main(int argc, char** argv) {
   }
 
   if (vs_file.empty()) vs_file = "fullscreen.vs.glsl";
-  if (fs_file.empty()) {
-    if (use_nv12) {
-      fs_file = use_zero_copy ? "nv12_dmabuf.fs.glsl" : "nv12.fs.glsl";
-    } else if (use_nv24) {
-      fs_file = use_zero_copy ? "nv24_dmabuf.fs.glsl" : "nv24.fs.glsl";
-    } else {
-      fs_file = "blit.fs.glsl";
-    }
-  }
   if (post_vs_file.empty()) post_vs_file = "fullscreen.vs.glsl";
 
   if (post_fs_file.empty() && enable_subpixel) {
@@ -577,20 +772,11 @@ int main(int argc, char** argv) {
     sub_left = 0;
   }
 
-  if (debug) {
-    std::fprintf(stderr,
-                 "[rock5b_hdmiin_gl] shader selection: two_pass=%d pre(vs=%s fs=%s) post(vs=%s fs=%s)\n",
-                 (!post_fs_file.empty()) ? 1 : 0,
-                 vs_file.c_str(), fs_file.c_str(),
-                 post_vs_file.c_str(), post_fs_file.c_str());
-    std::fprintf(stderr,
-                 "[rock5b_hdmiin_gl] postpass subpixel params (final): mx=%d my=%d views=%d wz=%d wn=%d test=%d left=%d mstart=%d hq=%d\n",
-                 sub_mx, sub_my, sub_views, sub_wz, sub_wn,
-                 sub_test, sub_left, sub_mstart, sub_hq);
-  }
-
   const bool two_pass = !post_fs_file.empty();
 
+  ProgramCache programs;
+  if (program_cache) programs.init(ProgramCache::default_dir(), debug);
+
   auto load_and_build_program = [&](const std::string& vs_name, const std::string& fs_name) -> GLuint {
     std::string vs_src = load_shader(shader_dir, vs_name);
     std::string fs_src = load_shader(shader_dir, fs_name);
@@ -601,28 +787,16 @@ int main(int argc, char** argv) {
       }
       return 0;
     }
-    GLuint vs = compile_shader(GL_VERTEX_SHADER, vs_src.c_str());
-    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fs_src.c_str());
-    if (!vs || !fs) return 0;
-    return link_program(vs, fs);
+    // Pre-pass programs are rebuilt on source changes; the cache makes that a blob load.
+    return programs.build(vs_src, fs_src);
   };
 
-  GLuint prog_pre = 0;
   GLuint prog_post = 0;
-
-  if (!two_pass) {
-    prog_pre = load_and_build_program(vs_file, fs_file);
-    if (!prog_pre) {
-      std::fprintf(stderr, "[rock5b_hdmiin_gl] program link failed\n");
-      return 6;
-    }
-  } else {
-    prog_pre = load_and_build_program("fullscreen.vs.glsl",
-                                      use_nv12 ? (use_zero_copy ? "nv12_dmabuf.fs.glsl" : "nv12.fs.glsl") :
-                                      (use_nv24 ? (use_zero_copy ? "nv24_dmabuf.fs.glsl" : "nv24.fs.glsl") : "blit.fs.glsl"));
+  if (two_pass) {
     prog_post = load_and_build_program(post_vs_file, post_fs_file);
-    if (!prog_pre || !prog_post) {
+    if (!prog_post) {
       std::fprintf(stderr, "[rock5b_hdmiin_gl] program link failed\n");
+      join_capture_init();
       return 6;
     }
   }
@@ -679,14 +853,6 @@ int main(int argc, char** argv) {
     }
   }
 
-  GLint a_pos_pre = glGetAttribLocation(prog_pre, "a_pos");
-  GLint a_uv_pre = glGetAttribLocation(prog_pre, "a_uv");
-  GLint u_tex_pre = use_yuv ? -1 : glGetUniformLocation(prog_pre, "u_tex");
-  GLint u_tex_y_pre = use_yuv ? glGetUniformLocation(prog_pre, "u_tex_y") : -1;
-  GLint u_tex_uv_pre = use_yuv ? glGetUniformLocation(prog_pre, "u_tex_uv") : -1;
-  GLint u_uvSwap_pre = use_yuv ? glGetUniformLocation(prog_pre, "u_uvSwap") : -1;
-  GLint u_uvRA_pre = use_zero_copy ? glGetUniformLocation(prog_pre, "u_uvRA") : -1;
-
   GLint a_pos_post = -1;
   GLint a_uv_post = -1;
   GLint u_tex_post = -1;
@@ -696,38 +862,456 @@ int main(int argc, char** argv) {
     u_tex_post = glGetUniformLocation(prog_post, "u_tex");
   }
 
-  if (debug) {
-    std::fprintf(stderr, "[rock5b_hdmiin_gl] pipeline: nv12=%d zero_copy=%d two_pass=%d\n", use_nv12 ? 1 : 0, use_zero_copy ? 1 : 0, two_pass ? 1 : 0);
-    std::fprintf(stderr, "[rock5b_hdmiin_gl] pre a_pos=%d a_uv=%d u_tex=%d u_tex_y=%d u_tex_uv=%d u_uvSwap=%d\n",
-                 (int)a_pos_pre, (int)a_uv_pre, (int)u_tex_pre, (int)u_tex_y_pre, (int)u_tex_uv_pre, (int)u_uvSwap_pre);
-    std::fprintf(stderr, "[rock5b_hdmiin_gl] pre u_uvRA=%d (dmabuf_uv_ra=%d)\n", (int)u_uvRA_pre, dmabuf_uv_ra ? 1 : 0);
-    if (two_pass) {
-      std::fprintf(stderr, "[rock5b_hdmiin_gl] post a_pos=%d a_uv=%d u_tex=%d\n", (int)a_pos_post, (int)a_uv_post, (int)u_tex_post);
-    }
+  // Zero-copy entry points, looked up once; whether they are used depends on the format.
+  PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES_ptr = nullptr;
+  PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR_ptr = nullptr;
+  PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR_ptr = nullptr;
+  if (egl_has_dmabuf_import) {
+    glEGLImageTargetTexture2DOES_ptr = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC)eglGetProcAddress("glEGLImageTargetTexture2DOES");
+    eglCreateImageKHR_ptr = (PFNEGLCREATEIMAGEKHRPROC)eglGetProcAddress("eglCreateImageKHR");
+    eglDestroyImageKHR_ptr = (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
   }
+  const bool egl_zero_copy_procs = glEGLImageTargetTexture2DOES_ptr && eglCreateImageKHR_ptr && eglDestroyImageKHR_ptr;
+  const char* gl_ext = (const char*)glGetString(GL_EXTENSIONS);
+  const bool gl_has_image_external = gl_ext && std::strstr(gl_ext, "GL_OES_EGL_image_external");
+  GpuTimer gpu_timer;
+  if (!gpu_timer.init() && debug) std::fprintf(stderr, "[rock5b_hdmiin_gl] GL_EXT_disjoint_timer_query missing; no GPU timings\n");
+
+  // Imports one plane of a V4L2 dmabuf as an EGLImage.
+  auto create_dmabuf_image = [&](const DmabufPlane& plane, uint32_t drm_fourcc, int w, int h) -> EGLImageKHR {
+    const EGLint attr[] = {
+        EGL_WIDTH, w,
+        EGL_HEIGHT, h,
+        EGL_LINUX_DRM_FOURCC_EXT, (EGLint)drm_fourcc,
+        EGL_DMA_BUF_PLANE0_FD_EXT, plane.fd,
+        EGL_DMA_BUF_PLANE0_OFFSET_EXT, (EGLint)plane.offset,
+        EGL_DMA_BUF_PLANE0_PITCH_EXT, (EGLint)plane.pitch,
+        EGL_NONE};
+    return eglCreateImageKHR_ptr(gfx.egl_display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, (EGLClientBuffer)nullptr, attr);
+  };
+
+  // Imports a whole 2- or 3-plane buffer as one YUV EGLImage; the driver's sampler does the
+  // colour conversion, so the colorimetry goes in as hints instead of shader uniforms.
+  auto create_yuv_image = [&](const DmabufPlane* planes, int nplanes, uint32_t drm_fourcc, int w, int h, Colorimetry c) -> EGLImageKHR {
+    static const EGLint kPlaneAttrs[3][3] = {
+        {EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE0_OFFSET_EXT, EGL_DMA_BUF_PLANE0_PITCH_EXT},
+        {EGL_DMA_BUF_PLANE1_FD_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT, EGL_DMA_BUF_PLANE1_PITCH_EXT},
+        {EGL_DMA_BUF_PLANE2_FD_EXT, EGL_DMA_BUF_PLANE2_OFFSET_EXT, EGL_DMA_BUF_PLANE2_PITCH_EXT},
+    };
+    const EGLint color_space = (c.matrix == YuvMatrix::Bt709) ? EGL_ITU_REC709_EXT : (c.matrix == YuvMatrix::Bt2020) ? EGL_ITU_REC2020_EXT : EGL_ITU_REC601_EXT;
+    const EGLint range = (c.range == YuvRange::Full) ? EGL_YUV_FULL_RANGE_EXT : EGL_YUV_NARROW_RANGE_EXT;
+    std::vector<EGLint> attr = {
+        EGL_WIDTH, w,
+        EGL_HEIGHT, h,
+        EGL_LINUX_DRM_FOURCC_EXT, (EGLint)drm_fourcc,
+        EGL_YUV_COLOR_SPACE_HINT_EXT, color_space,
+        EGL_SAMPLE_RANGE_HINT_EXT, range,
+        // HDMI chroma siting: co-sited with the left luma sample, and for 4:2:0 centred
+        // vertically. Hints for a direction without subsampling (4:2:2 vertically, 4:4:4) are
+        // ignored.
+        EGL_YUV_CHROMA_HORIZONTAL_SITING_HINT_EXT, EGL_YUV_CHROMA_SITING_0_EXT,
+        EGL_YUV_CHROMA_VERTICAL_SITING_HINT_EXT, EGL_YUV_CHROMA_SITING_0_5_EXT,
+    };
+    for (int p = 0; p < nplanes && p < 3; p++) {
+      attr.insert(attr.end(), {kPlaneAttrs[p][0], planes[p].fd, kPlaneAttrs[p][1], (EGLint)planes[p].offset, kPlaneAttrs[p][2], (EGLint)planes[p].pitch});
+    }
+    attr.push_back(EGL_NONE);
+    return eglCreateImageKHR_ptr(gfx.egl_display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, (EGLClientBuffer)nullptr, attr.data());
+  };
+
+  auto create_image_texture = [&](EGLImageKHR img, GLint filter, GLenum target = GL_TEXTURE_2D) -> GLuint {
+    GLuint t = 0;
+    glGenTextures(1, &t);
+    glBindTexture(target, t);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glEGLImageTargetTexture2DOES_ptr(target, (GLeglImageOES)img);
+    return t;
+  };
+
+  // Everything that depends on the negotiated capture format: rebuilt in place by
+  // setup_source_pipeline() when the HDMI source changes, without touching DRM/EGL.
+  bool use_nv12 = false;
+  bool use_nv16 = false;
+  bool use_nv24 = false;
+  // Three planes (YUV420M): U and V are separate R8 textures.
+  bool use_yuv420p = false;
+  bool use_yuv = false;
+  bool use_uyvy = false;
+  bool use_packed422 = false;
+  bool use_bgr24 = false;
+  bool use_packed = false;
+  bool use_zero_copy = false;
+  // NV12/NV16/NV24/YUV420M imported as one YUV EGLImage per buffer and sampled via
+  // samplerExternalOES.
+  bool use_external = false;
+  // Capture buffers flipped straight onto a KMS plane (direct_scanout); GL stays set up as the
+  // fallback but draws nothing.
+  bool use_direct = false;
+  std::vector<uint32_t> direct_fbs;
+  // Packed 4:2:2 texels hold two pixels each, so they must not be filtered.
+  GLint packed_filter = GL_LINEAR;
+
+  GLuint prog_pre = 0;
+  GLint a_pos_pre = -1;
+  GLint a_uv_pre = -1;
+  GLint u_tex_pre = -1;
+  GLint u_tex_y_pre = -1;
+  GLint u_tex_uv_pre = -1;
+  GLint u_tex_v_pre = -1;
+  GLint u_uvSwap_pre = -1;
+  GLint u_uvRA_pre = -1;
+  GLint u_texSize_pre = -1;
+  GLint u_uyvy_pre = -1;
+  GLint u_yuvMat_pre = -1;
+  GLint u_yuvOffset_pre = -1;
+  YuvShaderMatrix yuv_mat = yuv_shader_matrix(Colorimetry{});
 
   GLuint tex = 0;
   GLuint tex_y = 0;
   GLuint tex_uv = 0;
+  GLuint tex_v = 0;
 
-  PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES_ptr = nullptr;
-  PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR_ptr = nullptr;
-  PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR_ptr = nullptr;
+  // Chroma plane size in samples for the negotiated YUV layout.
+  auto chroma_w = [&](uint32_t w) { return use_nv24 ? w : w / 2; };
+  auto chroma_h = [&](uint32_t h) { return (use_nv24 || use_nv16) ? h : h / 2; };
 
   std::vector<EGLImageKHR> y_images;
   std::vector<EGLImageKHR> uv_images;
+  std::vector<EGLImageKHR> v_images;
   std::vector<GLuint> y_texs;
   std::vector<GLuint> uv_texs;
+  std::vector<GLuint> v_texs;
+  std::vector<EGLImageKHR> packed_images;
+  std::vector<GLuint> packed_texs;
+  std::vector<EGLImageKHR> yuv_images;
+  std::vector<GLuint> yuv_texs;
+
+  auto destroy_yuv_images = [&]() {
+    for (EGLImageKHR img : yuv_images) {
+      if (img != EGL_NO_IMAGE_KHR) eglDestroyImageKHR_ptr(gfx.egl_display, img);
+    }
+    if (!yuv_texs.empty()) glDeleteTextures((GLsizei)yuv_texs.size(), yuv_texs.data());
+    yuv_images.clear();
+    yuv_texs.clear();
+  };
+
+  // All-or-nothing: if any buffer fails to import, the caller falls back to the R8/GR88 path.
+  auto import_yuv_images = [&]() -> bool {
+    uint32_t drm_fourcc = nv21 ? DRM_FORMAT_NV21 : DRM_FORMAT_NV12;
+    if (use_nv24) drm_fourcc = nv21 ? DRM_FORMAT_NV42 : DRM_FORMAT_NV24;
+    if (use_nv16) drm_fourcc = nv21 ? DRM_FORMAT_NV61 : DRM_FORMAT_NV16;
+    if (use_yuv420p) drm_fourcc = nv21 ? DRM_FORMAT_YVU420 : DRM_FORMAT_YUV420;
+    const int nplanes = use_yuv420p ? 3 : 2;
+    const size_t nbuf = (size_t)cap.buffer_count();
+    yuv_images.assign(nbuf, EGL_NO_IMAGE_KHR);
+    yuv_texs.assign(nbuf, 0);
+    for (size_t i = 0; i < nbuf; i++) {
+      DmabufPlane planes[3];
+      bool have_planes = true;
+      for (int p = 0; p < nplanes; p++) have_planes = have_planes && cap.dmabuf_plane((uint32_t)i, (uint32_t)p, planes[p]);
+      if (!have_planes) break;
+      yuv_images[i] = create_yuv_image(planes, nplanes, drm_fourcc, (int)cap.width(), (int)cap.height(), cap.colorimetry());
+      if (yuv_images[i] == EGL_NO_IMAGE_KHR) {
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] YUV EGLImage import failed (err=0x%x), using per-plane import\n", (unsigned)eglGetError());
+        break;
+      }
+      yuv_texs[i] = create_image_texture(yuv_images[i], GL_LINEAR, GL_TEXTURE_EXTERNAL_OES);
+    }
+    if (!yuv_texs.empty() && yuv_texs.back() != 0) return true;
+    destroy_yuv_images();
+    return false;
+  };
+
+  auto destroy_plane_images = [&]() {
+    for (size_t i = 0; i < y_images.size(); i++) {
+      if (y_images[i] != EGL_NO_IMAGE_KHR) eglDestroyImageKHR_ptr(gfx.egl_display, y_images[i]);
+      if (uv_images[i] != EGL_NO_IMAGE_KHR) eglDestroyImageKHR_ptr(gfx.egl_display, uv_images[i]);
+      if (i < v_images.size() && v_images[i] != EGL_NO_IMAGE_KHR) eglDestroyImageKHR_ptr(gfx.egl_display, v_images[i]);
+    }
+    if (!y_texs.empty()) glDeleteTextures((GLsizei)y_texs.size(), y_texs.data());
+    if (!uv_texs.empty()) glDeleteTextures((GLsizei)uv_texs.size(), uv_texs.data());
+    if (!v_texs.empty()) glDeleteTextures((GLsizei)v_texs.size(), v_texs.data());
+    y_images.clear();
+    uv_images.clear();
+    v_images.clear();
+    y_texs.clear();
+    uv_texs.clear();
+    v_texs.clear();
+  };
+
+  // Per-plane R8/GR88 (or three R8) images for every capture buffer, built before the first
+  // frame so it renders without import work. All-or-nothing, like import_yuv_images().
+  auto import_plane_images = [&]() -> bool {
+    const size_t nbuf = (size_t)cap.buffer_count();
+    y_images.assign(nbuf, EGL_NO_IMAGE_KHR);
+    uv_images.assign(nbuf, EGL_NO_IMAGE_KHR);
+    y_texs.assign(nbuf, 0);
+    uv_texs.assign(nbuf, 0);
+    if (use_yuv420p) {
+      v_images.assign(nbuf, EGL_NO_IMAGE_KHR);
+      v_texs.assign(nbuf, 0);
+    }
+
+    bool ok = nbuf > 0;
+    for (size_t i = 0; ok && i < nbuf; i++) {
+      // Luma and chroma each come with their own fd/offset/pitch, so contiguous NV12
+      // and multi-planar NV12M import the same way.
+      DmabufPlane y_plane;
+      DmabufPlane uv_plane;
+      DmabufPlane v_plane;
+      if (!cap.dmabuf_plane((uint32_t)i, 0, y_plane) || !cap.dmabuf_plane((uint32_t)i, 1, uv_plane) ||
+          (use_yuv420p && !cap.dmabuf_plane((uint32_t)i, 2, v_plane))) {
+        if (debug) std::fprintf(stderr, "[rock5b_hdmiin_gl] dmabuf planes of buffer %zu unavailable\n", i);
+        ok = false;
+        break;
+      }
+
+      const int y_w = (int)cap.width();
+      const int y_h = (int)cap.height();
+      const int uv_w = (int)chroma_w(cap.width());
+      const int uv_h = (int)chroma_h(cap.height());
+      if (debug && i == 0) {
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] dmabuf planes: y(fd=%d off=%u pitch=%u) uv(fd=%d off=%u pitch=%u)\n",
+                     y_plane.fd, y_plane.offset, y_plane.pitch, uv_plane.fd, uv_plane.offset, uv_plane.pitch);
+      }
+
+      y_images[i] = create_dmabuf_image(y_plane, DRM_FORMAT_R8, y_w, y_h);
+      uv_images[i] = create_dmabuf_image(uv_plane, use_yuv420p ? DRM_FORMAT_R8 : DRM_FORMAT_GR88, uv_w, uv_h);
+      if (use_yuv420p) v_images[i] = create_dmabuf_image(v_plane, DRM_FORMAT_R8, uv_w, uv_h);
+      if (y_images[i] == EGL_NO_IMAGE_KHR || uv_images[i] == EGL_NO_IMAGE_KHR || (use_yuv420p && v_images[i] == EGL_NO_IMAGE_KHR)) {
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] eglCreateImageKHR failed (err=0x%x), using texture upload\n", (unsigned)eglGetError());
+        ok = false;
+        break;
+      }
+
+      y_texs[i] = create_image_texture(y_images[i], GL_LINEAR);
+      uv_texs[i] = create_image_texture(uv_images[i], GL_LINEAR);
+      if (use_yuv420p) v_texs[i] = create_image_texture(v_images[i], GL_LINEAR);
+    }
+    if (!ok) destroy_plane_images();
+    return ok;
+  };
+
+  auto destroy_packed_images = [&]() {
+    for (size_t i = 0; i < packed_images.size(); i++) {
+      if (packed_images[i] != EGL_NO_IMAGE_KHR) eglDestroyImageKHR_ptr(gfx.egl_display, packed_images[i]);
+    }
+    if (!packed_texs.empty()) glDeleteTextures((GLsizei)packed_texs.size(), packed_texs.data());
+    packed_images.clear();
+    packed_texs.clear();
+  };
+
+  // Packed 4:2:2 / BGR24 images for every capture buffer; all-or-nothing.
+  auto import_packed_images = [&]() -> bool {
+    // Packed 4:2:2 is one RGBA texel per pixel pair; BGR24 is one RGB texel per pixel.
+    const int tw = (int)(use_packed422 ? (cap.width() / 2) : cap.width());
+    const int th = (int)cap.height();
+    const size_t nbuf = (size_t)cap.buffer_count();
+    packed_images.assign(nbuf, EGL_NO_IMAGE_KHR);
+    packed_texs.assign(nbuf, 0);
+    // ABGR8888 is R,G,B,A in memory: Y0,U,Y1,V (or U,Y0,V,Y1) per texel.
+    // BGR888 is R,G,B in memory, so BGR24 samples with R/B swapped exactly like the
+    // texture upload path and both go through blit_bgr.fs.glsl.
+    const uint32_t drm_format = use_packed422 ? DRM_FORMAT_ABGR8888 : DRM_FORMAT_BGR888;
+    bool ok = nbuf > 0;
+    for (size_t i = 0; i < nbuf; i++) {
+      DmabufPlane plane;
+      if (cap.dmabuf_plane((uint32_t)i, 0, plane)) packed_images[i] = create_dmabuf_image(plane, drm_format, tw, th);
+      if (packed_images[i] == EGL_NO_IMAGE_KHR) {
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] packed EGLImage import failed (err=0x%x), using texture upload\n", (unsigned)eglGetError());
+        ok = false;
+        break;
+      }
+      packed_texs[i] = create_image_texture(packed_images[i], packed_filter);
+    }
+    if (!ok) destroy_packed_images();
+    return ok;
+  };
+
+  auto destroy_direct_scanout = [&]() {
+    if (use_direct) drm_gbm_egl_scanout_end(gfx);
+    for (uint32_t fb : direct_fbs) drm_gbm_egl_remove_fb(gfx, fb);
+    direct_fbs.clear();
+    use_direct = false;
+  };
+
+  // Wraps every capture buffer in a KMS framebuffer and finds a plane that scans it out. Only
+  // for plain passthrough: anything the shaders would change on the way keeps GL.
+  auto setup_direct_scanout = [&]() -> bool {
+    const uint32_t format = direct_scanout_format(cap.fourcc(), nv21);
+    const char* why = nullptr;
+    if (!gfx.atomic) why = "atomic KMS unavailable";
+    else if (two_pass) why = "post-pass shader active";
+    else if (!fs_file.empty()) why = "custom fragment shader";
+    else if (flip_y) why = "flip_y";
+    else if (test_clear) why = "test_clear";
+    else if (disable_zero_copy) why = "zero-copy disabled";
+    else if (!format) why = "capture format has no scanout equivalent";
+    else if (!cap.dmabuf_export_supported()) why = "capture buffers not exportable";
+    if (why) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] direct scanout off (%s), rendering with GL\n", why);
+      return false;
+    }
+
+    const int nplanes = use_yuv420p ? 3 : 2;
+    const size_t nbuf = (size_t)cap.buffer_count();
+    direct_fbs.assign(nbuf, 0);
+    bool ok = nbuf > 0;
+    for (size_t i = 0; ok && i < nbuf; i++) {
+      int fds[3] = {};
+      uint32_t offsets[3] = {};
+      uint32_t pitches[3] = {};
+      for (int p = 0; ok && p < nplanes; p++) {
+        DmabufPlane plane;
+        ok = cap.dmabuf_plane((uint32_t)i, (uint32_t)p, plane);
+        fds[p] = plane.fd;
+        offsets[p] = plane.offset;
+        pitches[p] = plane.pitch;
+      }
+      if (ok) direct_fbs[i] = drm_gbm_egl_add_dmabuf_fb(gfx, cap.width(), cap.height(), format, fds, offsets, pitches, nplanes);
+      ok = ok && direct_fbs[i] != 0;
+    }
+    use_direct = ok && drm_gbm_egl_scanout_begin(gfx, format, direct_fbs[0], cap.width(), cap.height(), cap.colorimetry());
+    if (!use_direct) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] no plane scans out %ux%u fourcc=0x%08x, rendering with GL\n", cap.width(), cap.height(), cap.fourcc());
+      destroy_direct_scanout();
+      return false;
+    }
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] direct scanout on plane %u (%s), GPU idle\n", gfx.scanout_plane_id,
+                 gfx.scanout_plane_id == gfx.plane_id ? "primary" : "overlay");
+    return true;
+  };
+
+  auto destroy_source_pipeline = [&]() {
+    destroy_direct_scanout();
+    destroy_yuv_images();
+    destroy_plane_images();
+    destroy_packed_images();
+
+    const GLuint upload_texs[] = {tex, tex_y, tex_uv, tex_v};
+    glDeleteTextures(4, upload_texs);
+    tex = 0;
+    tex_y = 0;
+    tex_uv = 0;
+    tex_v = 0;
+
+    if (prog_pre) glDeleteProgram(prog_pre);
+    prog_pre = 0;
+  };
+
+  auto setup_source_pipeline = [&]() -> bool {
+    use_nv12 = (cap.fourcc() == V4L2_PIX_FMT_NV12) || (cap.fourcc() == V4L2_PIX_FMT_NV12M);
+    use_nv16 = (cap.fourcc() == V4L2_PIX_FMT_NV16) || (cap.fourcc() == V4L2_PIX_FMT_NV16M);
+    use_nv24 = (cap.fourcc() == V4L2_PIX_FMT_NV24);
+    use_yuv420p = (cap.fourcc() == V4L2_PIX_FMT_YUV420M);
+    use_yuv = use_nv12 || use_nv16 || use_nv24 || use_yuv420p;
+    // Packed 4:2:2 sampled as a half-width RGBA texture and decoded in the shader.
+    use_uyvy = (cap.fourcc() == V4L2_PIX_FMT_UYVY);
+    use_packed422 = gpu_yuv422 && ((cap.fourcc() == V4L2_PIX_FMT_YUYV) || use_uyvy);
+    // BGR24 sampled straight from the capture buffer; the R/B swap happens in blit_bgr.fs.glsl.
+    use_bgr24 = gpu_bgr24 && (cap.fourcc() == V4L2_PIX_FMT_BGR24);
+    // Single-plane formats handed to GL without a CPU conversion.
+    use_packed = use_packed422 || use_bgr24;
+    use_zero_copy = false;
+    if ((use_yuv || use_packed) && egl_has_dmabuf_import && cap.dmabuf_export_supported() && !disable_zero_copy) {
+      if (egl_zero_copy_procs) {
+        use_zero_copy = true;
+        if (debug) std::fprintf(stderr, "[rock5b_hdmiin_gl] zero-copy path enabled (DMABUF + EGLImage)\n");
+      } else {
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] zero-copy requested but EGL/GL entrypoints missing\n");
+      }
+    }
+    packed_filter = use_packed422 ? GL_NEAREST : GL_LINEAR;
+
+    // A custom --fs expects sampler2D planes, so the external sampler is only used with the
+    // built-in pre-pass shaders.
+    use_external = false;
+    if (yuv_external && use_yuv && use_zero_copy && (two_pass || fs_file.empty())) {
+      if (!gl_has_image_external) {
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] yuv_external requested but GL_OES_EGL_image_external is missing\n");
+      } else {
+        use_external = import_yuv_images();
+        if (use_external) std::fprintf(stderr, "[rock5b_hdmiin_gl] YUV sampled through samplerExternalOES (%s)\n", colorimetry_name(cap.colorimetry()));
+      }
+    }
+    // Import every buffer now rather than on the first frame; a failed import falls back to
+    // texture uploads before the shaders are chosen.
+    if (use_zero_copy && use_yuv && !use_external && !import_plane_images()) use_zero_copy = false;
+    if (use_zero_copy && use_packed && !import_packed_images()) use_zero_copy = false;
+
+    std::string pre_fs_file;
+    if (use_external) {
+      pre_fs_file = "yuv_external.fs.glsl";
+    } else if (use_yuv420p) {
+      pre_fs_file = "yuv420p.fs.glsl";
+    } else if (use_nv12 || use_nv16) {
+      // The chroma texture carries the subsampling, so NV16 shares the NV12 shaders.
+      pre_fs_file = use_zero_copy ? "nv12_dmabuf.fs.glsl" : "nv12.fs.glsl";
+    } else if (use_nv24) {
+      pre_fs_file = use_zero_copy ? "nv24_dmabuf.fs.glsl" : "nv24.fs.glsl";
+    } else if (use_packed422) {
+      pre_fs_file = "yuyv.fs.glsl";
+    } else if (use_bgr24) {
+      pre_fs_file = "blit_bgr.fs.glsl";
+    } else {
+      pre_fs_file = "blit.fs.glsl";
+    }
+    // --fs replaces the one-pass shader; otherwise it follows the capture format.
+    const std::string one_pass_fs = fs_file.empty() ? pre_fs_file : fs_file;
+
+    if (debug) {
+      std::fprintf(stderr,
+                   "[rock5b_hdmiin_gl] shader selection: two_pass=%d pre(vs=%s fs=%s) post(vs=%s fs=%s)\n",
+                   two_pass ? 1 : 0,
+                   vs_file.c_str(), one_pass_fs.c_str(),
+                   post_vs_file.c_str(), post_fs_file.c_str());
+      std::fprintf(stderr,
+                   "[rock5b_hdmiin_gl] postpass subpixel params (final): mx=%d my=%d views=%d wz=%d wn=%d test=%d left=%d mstart=%d hq=%d\n",
+                   sub_mx, sub_my, sub_views, sub_wz, sub_wn,
+                   sub_test, sub_left, sub_mstart, sub_hq);
+    }
+
+    prog_pre = two_pass ? load_and_build_program("fullscreen.vs.glsl", pre_fs_file) : load_and_build_program(vs_file, one_pass_fs);
+    if (!prog_pre) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] program link failed\n");
+      return false;
+    }
 
-  if (!use_yuv) {
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  } else {
-    if (!use_zero_copy) {
+    a_pos_pre = glGetAttribLocation(prog_pre, "a_pos");
+    a_uv_pre = glGetAttribLocation(prog_pre, "a_uv");
+    const bool yuv_planes = use_yuv && !use_external;
+    u_tex_pre = yuv_planes ? -1 : glGetUniformLocation(prog_pre, "u_tex");
+    u_tex_y_pre = yuv_planes ? glGetUniformLocation(prog_pre, "u_tex_y") : -1;
+    u_tex_uv_pre = yuv_planes ? glGetUniformLocation(prog_pre, use_yuv420p ? "u_tex_u" : "u_tex_uv") : -1;
+    u_tex_v_pre = (yuv_planes && use_yuv420p) ? glGetUniformLocation(prog_pre, "u_tex_v") : -1;
+    u_uvSwap_pre = yuv_planes ? glGetUniformLocation(prog_pre, "u_uvSwap") : -1;
+    u_uvRA_pre = (yuv_planes && use_zero_copy && !use_yuv420p) ? glGetUniformLocation(prog_pre, "u_uvRA") : -1;
+    u_texSize_pre = use_packed422 ? glGetUniformLocation(prog_pre, "u_texSize") : -1;
+    u_uyvy_pre = use_packed422 ? glGetUniformLocation(prog_pre, "u_uyvy") : -1;
+    u_yuvMat_pre = glGetUniformLocation(prog_pre, "u_yuvMat");
+    u_yuvOffset_pre = glGetUniformLocation(prog_pre, "u_yuvOffset");
+    yuv_mat = yuv_shader_matrix(cap.colorimetry());
+
+    if (debug) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] pipeline: nv12=%d packed422=%d bgr24=%d zero_copy=%d external=%d two_pass=%d\n",
+                   use_nv12 ? 1 : 0, use_packed422 ? 1 : 0, use_bgr24 ? 1 : 0, use_zero_copy ? 1 : 0, use_external ? 1 : 0, two_pass ? 1 : 0);
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] pre a_pos=%d a_uv=%d u_tex=%d u_tex_y=%d u_tex_uv=%d u_uvSwap=%d\n",
+                   (int)a_pos_pre, (int)a_uv_pre, (int)u_tex_pre, (int)u_tex_y_pre, (int)u_tex_uv_pre, (int)u_uvSwap_pre);
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] pre u_uvRA=%d (dmabuf_uv_ra=%d)\n", (int)u_uvRA_pre, dmabuf_uv_ra ? 1 : 0);
+    }
+
+    if (!use_yuv) {
+      glGenTextures(1, &tex);
+      glBindTexture(GL_TEXTURE_2D, tex);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, packed_filter);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, packed_filter);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    if (use_yuv && !use_zero_copy) {
       glGenTextures(1, &tex_y);
       glBindTexture(GL_TEXTURE_2D, tex_y);
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -741,15 +1325,27 @@ int main(int argc, char** argv) {
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    } else {
-      glEGLImageTargetTexture2DOES_ptr = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC)eglGetProcAddress("glEGLImageTargetTexture2DOES");
-      eglCreateImageKHR_ptr = (PFNEGLCREATEIMAGEKHRPROC)eglGetProcAddress("eglCreateImageKHR");
-      eglDestroyImageKHR_ptr = (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
-      if (!glEGLImageTargetTexture2DOES_ptr || !eglCreateImageKHR_ptr || !eglDestroyImageKHR_ptr) {
-        std::fprintf(stderr, "[rock5b_hdmiin_gl] zero-copy requested but EGL/GL entrypoints missing\n");
-        use_zero_copy = false;
+
+      if (use_yuv420p) {
+        glGenTextures(1, &tex_v);
+        glBindTexture(GL_TEXTURE_2D, tex_v);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
       }
     }
+    if (direct_scanout) setup_direct_scanout();
+    return true;
+  };
+
+  const uint64_t shaders_done_ns = monotonic_ns();
+  if (const int rc = join_capture_init()) return rc;
+  const uint64_t capture_ready_ns = monotonic_ns();
+  if (!setup_source_pipeline()) return 6;
+  const uint64_t pipeline_ready_ns = monotonic_ns();
+  if (two_pass && debug) {
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] post a_pos=%d a_uv=%d u_tex=%d\n", (int)a_pos_post, (int)a_uv_post, (int)u_tex_post);
   }
 
   bool tex_alloc = false;
@@ -765,6 +1361,8 @@ int main(int argc, char** argv) {
   GLuint cur_rgb_tex = 0;
   GLuint cur_y_tex = 0;
   GLuint cur_uv_tex = 0;
+  // Unit 3, so it stays clear of the FBO texture on unit 2.
+  GLuint cur_v_tex = 0;
 
   glViewport(0, 0, (GLsizei)gfx.mode_hdisplay, (GLsizei)gfx.mode_vdisplay);
 
@@ -813,31 +1411,231 @@ int main(int argc, char** argv) {
   uint64_t last_seen_flip_completed = gfx.pageflip_completed;
   int displayed_v4l2_index = -1;
   int pending_v4l2_index = -1;
+  // Vblank time of the last completed flip, for the paced frame policy's vblank prediction and
+  // for counting vblanks that repeated the previous frame.
+  uint64_t last_vblank_ns = 0;
+  uint64_t vblank_flips_seen = gfx.pageflip_completed;
+  uint64_t frames_shown = 0;
+  uint64_t frames_repeated = 0;
+  uint64_t last_frames_dropped = 0;
+  uint64_t last_frames_repeated = 0;
+  uint64_t last_frames_lost = 0;
+  // From each flip event's vblank timestamp back to the capture timestamp of the frame it
+  // showed: the whole run, and the current --debug stats window.
+  LatencyStats scanout_latency;
+  LatencyStats scanout_latency_window;
+  // Always collected; exported only when metrics_file is set.
+  Metrics metrics;
+  MetricsExporter metrics_exporter;
+  if (!metrics_file.empty() && !metrics_exporter.start(metrics, metrics_file, metrics_interval_ms)) {
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] metrics export to %s disabled\n", metrics_file.c_str());
+  }
+  uint64_t flip_submit_ns = 0;
+  auto publish_counters = [&]() {
+    metrics.frames_shown.store(frames_shown, std::memory_order_relaxed);
+    metrics.frames_dropped.store(cap.frames_dropped(), std::memory_order_relaxed);
+    metrics.frames_repeated.store(frames_repeated, std::memory_order_relaxed);
+    metrics.frames_lost.store(cap.frames_lost(), std::memory_order_relaxed);
+    metrics.flips_submitted.store(gfx.pageflip_submitted, std::memory_order_relaxed);
+    metrics.flips_completed.store(gfx.pageflip_completed, std::memory_order_relaxed);
+    metrics.flips_dropped.store(gfx.pageflip_dropped, std::memory_order_relaxed);
+  };
   bool first_frame_gl_checked = false;
-  uint64_t no_frame_ticks = 0;
+  bool startup_logged = false;
   uint32_t last_dbg_frame_index = 0;
   int64_t last_dbg_frame_ts_us = 0;
   timespec last_stat{};
   clock_gettime(CLOCK_MONOTONIC, &last_stat);
   uint32_t early_dbg_frames = 0;
-  while (g_running) {
-    if (test_clear) {
-      frame_counter++;
-      const float t = (float)(frame_counter % 120) / 120.0f;
-      glBindFramebuffer(GL_FRAMEBUFFER, 0);
-      glViewport(0, 0, (GLsizei)gfx.mode_hdisplay, (GLsizei)gfx.mode_vdisplay);
-      glClearColor(t, 0.2f, 1.0f - t, 1.0f);
-      glClear(GL_COLOR_BUFFER_BIT);
-      if (!drm_gbm_egl_swap_buffers(gfx)) {
-        std::fprintf(stderr, "[rock5b_hdmiin_gl] swap_buffers failed\n");
-        break;
+  // The first stats window covers warm-up (per-buffer EGLImages, FBO, texture storage);
+  // after that the loop is expected not to allocate.
+  uint64_t last_alloc_count = alloc_count();
+  bool alloc_warmup_done = false;
+
+  // One wakeup per event that can change what is on screen: a capture buffer becoming ready,
+  // a page flip completing, or the timer (flip watchdog, or pacing when nothing else paces).
+  // The V4L2 side is edge-triggered; capture_ready remembers an edge while a flip is pending.
+  // Source-change events arrive as POLLPRI on the V4L2 fd, which is also the capture fd
+  // unless the capture thread is running.
+  auto watch_capture = [&]() -> bool {
+    if (cap.event_fd() == cap.device_fd()) {
+      return loop.watch(cap.device_fd(), EventLoop::kCapture, true, EventLoop::kSourceChange);
+    }
+    return loop.watch(cap.event_fd(), EventLoop::kCapture, true) &&
+           loop.watch(cap.device_fd(), 0, true, EventLoop::kSourceChange);
+  };
+  auto unwatch_capture = [&]() {
+    if (cap.event_fd() != cap.device_fd()) loop.unwatch(cap.event_fd());
+    loop.unwatch(cap.device_fd());
+  };
+  if (!watch_capture() || !loop.watch(gfx.drm_fd, EventLoop::kDisplay)) {
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] event loop setup failed\n");
+    return 8;
+  }
+  const uint64_t frame_period_ns = drm_gbm_egl_frame_period_ns(gfx);
+  if (debug) std::fprintf(stderr, "[rock5b_hdmiin_gl] display frame period %.3f ms\n", (double)frame_period_ns / 1e6);
+  // A flip is due by the next vblank; two periods without its event means events are broken.
+  const uint64_t flip_watchdog_ns = 2 * frame_period_ns;
+  bool capture_ready = true;
+  bool present_due = test_clear;
+  bool flip_watchdog_armed = false;
+  // Late latch: the timer is set to the latch point, and rendering waits for it.
+  LateLatch latch;
+  latch.reset(frame_period_ns);
+  bool latch_armed = false;
+  bool latch_due = false;
+  bool latch_vrr_noted = false;
+  if (test_clear) loop.arm_timer(1);
+  // False while the input has no stable signal after a source change.
+  bool source_active = true;
+
+  // Stops capture, renegotiates format and buffers, and rebuilds the format-dependent GL
+  // state. DRM/KMS, EGL, the post-pass program and the FBO stay as they are.
+  auto renegotiate_source = [&]() -> bool {
+    timespec t0{};
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] source change: renegotiating capture\n");
+
+    // The GPU may still be sampling the old capture buffers.
+    glFinish();
+    unwatch_capture();
+    cap.stop();
+    // STREAMOFF handed every buffer back; nothing is left to QBUF.
+    displayed_v4l2_index = -1;
+    pending_v4l2_index = -1;
+    last_vblank_ns = 0;
+    latch.on_flip(0);
+    capture_ready = false;
+    if (source_active) destroy_source_pipeline();
+    source_active = false;
+    tex_alloc = false;
+
+    // Follow the new DV timings: a size pinned with --w/--h described the old input.
+    if (!cap.reconfigure(0, 0)) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] no usable input, waiting for the next source change\n");
+      return watch_capture();
+    }
+    if (!cap.start()) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] restart capture failed\n");
+      return false;
+    }
+    if (!setup_source_pipeline()) return false;
+    source_active = true;
+    capture_ready = true;
+    if (!watch_capture()) return false;
+
+    timespec t1{};
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    const double ms = (double)(t1.tv_sec - t0.tv_sec) * 1e3 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e6;
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] source change: %ux%u fourcc=0x%08x %s in %.1f ms\n",
+                 cap.width(), cap.height(), cap.fourcc(), colorimetry_name(cap.colorimetry()), ms);
+    return true;
+  };
+
+  // Once, when the first frame is submitted.
+  auto log_startup = [&]() {
+    if (startup_logged) return;
+    startup_logged = true;
+    const uint64_t now = monotonic_ns();
+    auto ms = [](uint64_t ns) { return (double)ns / 1e6; };
+    // V4L2 phases overlap drm/egl and shaders; "capture wait" is what the render thread
+    // still spent blocked on them.
+    std::fprintf(stderr,
+                 "[rock5b_hdmiin_gl] startup: drm/egl %.1f ms, v4l2 open %.1f, configure %.1f, start %.1f, shaders %.1f, "
+                 "capture wait %.1f, source pipeline %.1f, first frame %.1f (total %.1f ms)\n",
+                 ms(gfx_ready_ns - gfx_start_ns), ms(cap_open_ns), ms(cap_configure_ns), ms(cap_start_ns),
+                 ms(shaders_done_ns - gfx_ready_ns), ms(capture_ready_ns - shaders_done_ns),
+                 ms(pipeline_ready_ns - capture_ready_ns), ms(now - pipeline_ready_ns), ms(now - startup_t0_ns));
+  };
+
+  // After a present. A buffer the display reads directly (zero-copy or direct scanout) stays
+  // dequeued while it is on screen or about to be; anything else goes straight back to V4L2.
+  auto retire_frame = [&](const V4L2Frame& frame, bool held_by_display, bool flipped) -> bool {
+    auto release_index = [&](int index) {
+      V4L2Frame rel;
+      rel.needs_release = true;
+      rel.index = (uint32_t)index;
+      return cap.release_frame(rel);
+    };
+    if (!held_by_display) return release_index((int)frame.index);
+    // If DRM pageflip events are not being used (e.g. SetCrtc fallback), pageflip_completed
+    // will not advance, so we must release buffers based on successful swaps.
+    if (!gfx.pageflip_enabled || !gfx.pageflip_use_event) {
+      if (displayed_v4l2_index >= 0 && !release_index(displayed_v4l2_index)) return false;
+      displayed_v4l2_index = (int)frame.index;
+      pending_v4l2_index = -1;
+      return true;
+    }
+    if (flipped) {
+      pending_v4l2_index = (int)frame.index;
+    } else if (displayed_v4l2_index < 0) {
+      displayed_v4l2_index = (int)frame.index;
+    } else {
+      return release_index((int)frame.index);
+    }
+    return true;
+  };
+
+  while (!loop.quit_requested()) {
+    const uint32_t fired = loop.wait(debug ? 1000 : -1);
+    if (fired & EventLoop::kDisplay) {
+      if (!drm_gbm_egl_handle_events(gfx)) break;
+      if (gfx.pageflip_completed > vblank_flips_seen) {
+        vblank_flips_seen = gfx.pageflip_completed;
+        const uint64_t vblank_ns = gfx.last_flip_ns;
+        // Flips only follow new frames, so each extra vblank since the last flip showed the
+        // previous frame again. Under VRR the refresh waits for the flip, so gaps are not repeats.
+        if (!gfx.vrr && last_vblank_ns != 0 && vblank_ns > last_vblank_ns && source_active && frame_period_ns > 0) {
+          const uint64_t vblanks = (vblank_ns - last_vblank_ns + frame_period_ns / 2) / frame_period_ns;
+          if (vblanks > 1) frames_repeated += vblanks - 1;
+        }
+        last_vblank_ns = vblank_ns;
+        latch.on_flip(vblank_ns);
+        latch_due = false;
+        const FlipTag& shown = gfx.last_flip_tag;
+        if (shown.capture_ns != 0 && vblank_ns > shown.capture_ns) {
+          const uint64_t latency_ns = vblank_ns - shown.capture_ns;
+          scanout_latency.add(latency_ns);
+          scanout_latency_window.add(latency_ns);
+          metrics.scanout.observe_ns(latency_ns);
+          cap.note_present_latency(latency_ns);
+        }
+        if (flip_submit_ns != 0 && vblank_ns > flip_submit_ns) metrics.flip_wait.observe_ns(vblank_ns - flip_submit_ns);
+        flip_submit_ns = 0;
+        publish_counters();
       }
-      glFlush();
-      usleep(16000);
-      continue;
+      if (flip_watchdog_armed && !gfx.pageflip_pending) {
+        loop.arm_timer(0);
+        flip_watchdog_armed = false;
+      }
+    }
+    if (fired & EventLoop::kTimer) {
+      const bool flip_late = flip_watchdog_armed && gfx.pageflip_pending;
+      if (flip_late) drm_gbm_egl_pageflip_timeout(gfx);
+      present_due = test_clear;
+      flip_watchdog_armed = false;
+      if (latch_armed) {
+        latch_armed = false;
+        latch_due = true;
+      }
+      // An atomic commit that has not retired yet stays pending; keep watching it.
+      if (flip_late && gfx.pageflip_pending) {
+        loop.arm_timer(flip_watchdog_ns);
+        flip_watchdog_armed = true;
+      }
+    }
+    if (fired & EventLoop::kCapture) capture_ready = true;
+    if (fired & EventLoop::kSourceChange) {
+      bool source_changed = false;
+      if (!cap.dequeue_events(source_changed)) {
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] VIDIOC_DQEVENT failed: %s\n", std::strerror(errno));
+      }
+      if (source_changed && !renegotiate_source()) break;
     }
+    if (debug && fired == 0) std::fprintf(stderr, "[rock5b_hdmiin_gl] waiting for frames...\n");
+    if (loop.quit_requested()) break;
 
-    if (use_zero_copy) {
+    if (use_zero_copy || use_direct) {
       while (gfx.pageflip_completed > last_seen_flip_completed) {
         last_seen_flip_completed++;
         if (displayed_v4l2_index >= 0) {
@@ -854,11 +1652,76 @@ int main(int argc, char** argv) {
       }
     }
 
+    // Render only once the previous flip has landed; the flip event wakes us again.
+    if (gfx.pageflip_pending) continue;
+
+    if (test_clear) {
+      if (!present_due && (fired & EventLoop::kDisplay) == 0) continue;
+      present_due = false;
+      frame_counter++;
+      const float t = (float)(frame_counter % 120) / 120.0f;
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      glViewport(0, 0, (GLsizei)gfx.mode_hdisplay, (GLsizei)gfx.mode_vdisplay);
+      glClearColor(t, 0.2f, 1.0f - t, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT);
+      if (!drm_gbm_egl_swap_buffers(gfx)) {
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] swap_buffers failed\n");
+        break;
+      }
+      glFlush();
+      // Paced by the flip event, or by the timer when presenting without events.
+      flip_watchdog_armed = gfx.pageflip_pending;
+      loop.arm_timer(gfx.pageflip_pending ? flip_watchdog_ns : frame_period_ns);
+      continue;
+    }
+
+    if (!source_active || !capture_ready) continue;
+    // With VRR there is no fixed vblank to aim at: a flip starts the refresh itself. gfx.vrr is
+    // only final after the first modeset, which falls back to a fixed refresh if VRR is refused.
+    if (late_latch && gfx.vrr && gfx.modeset_done && !latch_vrr_noted) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] VRR active, late latch disabled\n");
+      latch_vrr_noted = true;
+    }
+    if (late_latch && !gfx.vrr && !latch_due) {
+      // Hold the frame until the latch point; frames captured meanwhile replace it.
+      const uint64_t now_ns = monotonic_ns();
+      const uint64_t start_ns = latch.start_time(now_ns);
+      if (start_ns > now_ns) {
+        if (!latch_armed) {
+          loop.arm_timer(start_ns - now_ns);
+          latch_armed = true;
+        }
+        continue;
+      }
+    }
+    latch_due = false;
+    latch_armed = false;
+    capture_ready = false;
+
+    // Imported capture buffers are only cache-synced when the CPU is going to read them.
+    cap.set_cpu_plane_access(!(use_zero_copy || use_direct) || debug);
+
+    // The vblank this frame will be scanned out at: the one after the last flip, or later if
+    // that has already passed. Under VRR it is whenever the flip lands, so the newest frame is
+    // always the right one.
+    uint64_t present_ns = 0;
+    if (!gfx.vrr && last_vblank_ns != 0 && frame_period_ns > 0) {
+      timespec now{};
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      const uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+      present_ns = last_vblank_ns + frame_period_ns;
+      if (present_ns < now_ns) present_ns += ((now_ns - present_ns) / frame_period_ns + 1) * frame_period_ns;
+    }
+
     V4L2Frame frame;
-    if (!cap.acquire_frame(frame)) {
+    const uint64_t acquire_start_ns = monotonic_ns();
+    if (late_latch) latch.begin(acquire_start_ns);
+    if (!cap.acquire_frame(frame, present_ns)) {
       std::fprintf(stderr, "[rock5b_hdmiin_gl] cap.acquire_frame failed\n");
       break;
     }
+    const uint64_t acquire_end_ns = monotonic_ns();
+    if (frame.needs_release || frame.data) metrics.acquire.observe_ns(acquire_end_ns - acquire_start_ns);
 
     const bool dbg_early = debug && (early_dbg_frames < 60);
     if (dbg_early) {
@@ -901,17 +1764,6 @@ int main(int argc, char** argv) {
                    (unsigned)uv_fp);
     }
 
-    if (debug) {
-      if (!frame.needs_release) {
-        no_frame_ticks++;
-        if ((no_frame_ticks % 60) == 0) {
-          std::fprintf(stderr, "[rock5b_hdmiin_gl] waiting for frames...\n");
-        }
-      } else {
-        no_frame_ticks = 0;
-      }
-    }
-
     if (debug) {
       timespec now{};
       clock_gettime(CLOCK_MONOTONIC, &now);
@@ -923,16 +1775,41 @@ int main(int argc, char** argv) {
         uint64_t ddrop = gfx.pageflip_dropped - last_flip_dropped;
         int64_t cur_ts_us = (int64_t)frame.ts_sec * 1000000LL + (int64_t)frame.ts_usec;
         int64_t dts_us = (last_dbg_frame_ts_us == 0) ? 0 : (cur_ts_us - last_dbg_frame_ts_us);
-        std::fprintf(stderr, "[rock5b_hdmiin_gl] fps=%.1f flips(sub=%llu com=%llu drop=%llu)\n",
+        const uint64_t cap_dropped = cap.frames_dropped();
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] fps=%.1f flips(sub=%llu com=%llu drop=%llu) frames(dropped=%llu repeated=%llu)\n",
                      (double)df / dt,
                      (unsigned long long)dsub,
                      (unsigned long long)dcom,
-                     (unsigned long long)ddrop);
+                     (unsigned long long)ddrop,
+                     (unsigned long long)(cap_dropped - last_frames_dropped),
+                     (unsigned long long)(frames_repeated - last_frames_repeated));
+        last_frames_dropped = cap_dropped;
+        last_frames_repeated = frames_repeated;
+        const uint64_t cap_lost = cap.frames_lost();
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] capture->scanout avg=%.2f min=%.2f max=%.2f ms over %llu flips, lost=%llu (seq %u)\n",
+                     scanout_latency_window.avg_ms(), (double)scanout_latency_window.min_ns / 1e6,
+                     (double)scanout_latency_window.max_ns / 1e6, (unsigned long long)scanout_latency_window.count,
+                     (unsigned long long)(cap_lost - last_frames_lost), (unsigned)frame.sequence);
+        last_frames_lost = cap_lost;
+        scanout_latency_window = LatencyStats{};
+        if (late_latch) {
+          std::fprintf(stderr, "[rock5b_hdmiin_gl] late latch: render=%.2f margin=%.2f ms, %llu misses\n",
+                       (double)latch.cost_ns() / 1e6, (double)latch.margin_ns() / 1e6, (unsigned long long)latch.misses());
+        }
         std::fprintf(stderr, "[rock5b_hdmiin_gl] cap dbg: needs_release=%d idx=%u ts_us=%lld dts_us=%lld\n",
                      frame.needs_release ? 1 : 0,
                      (unsigned)frame.index,
                      (long long)cur_ts_us,
                      (long long)dts_us);
+        if (alloc_counter_enabled()) {
+          const uint64_t allocs = alloc_count();
+          if (alloc_warmup_done && allocs != last_alloc_count) {
+            std::fprintf(stderr, "[rock5b_hdmiin_gl] WARNING: %llu heap allocations in the render loop during the last %.1fs\n",
+                         (unsigned long long)(allocs - last_alloc_count), dt);
+          }
+          last_alloc_count = allocs;
+          alloc_warmup_done = true;
+        }
         last_stat = now;
         last_frame_counter = frame_counter;
         last_flip_submitted = gfx.pageflip_submitted;
@@ -943,144 +1820,162 @@ int main(int argc, char** argv) {
       }
     }
 
-    if (frame.needs_release) {
-      frame_counter++;
-      if (debug && (frame_counter % 60) == 0 && frame.ts_sec != 0) {
-        timespec now{};
-        clock_gettime(CLOCK_MONOTONIC, &now);
-        int64_t now_us = (int64_t)now.tv_sec * 1000000LL + (int64_t)now.tv_nsec / 1000LL;
-        int64_t cap_us = frame.ts_sec * 1000000LL + frame.ts_usec;
-        std::fprintf(stderr, "[rock5b_hdmiin_gl] capture_age_ms=%.1f\n", (double)(now_us - cap_us) / 1000.0);
-      }
-    }
+    if (frame.needs_release) frame_counter++;
 
-    if (!frame.needs_release && frame.data.empty() && !use_yuv) {
-      if (!drm_gbm_egl_swap_buffers(gfx)) {
-        std::fprintf(stderr, "[rock5b_hdmiin_gl] swap_buffers failed\n");
-        break;
-      }
-      continue;
-    }
+    // Spurious wakeup (e.g. the capture thread dropped the frame): keep what is on screen.
+    if (!frame.needs_release && !frame.data) continue;
+    frames_shown++;
 
-    if (use_yuv) {
-      if (!frame.needs_release) {
-        if (!drm_gbm_egl_swap_buffers(gfx)) {
-          std::fprintf(stderr, "[rock5b_hdmiin_gl] swap_buffers failed\n");
+    if (use_direct) {
+      const uint32_t fb = frame.index < direct_fbs.size() ? direct_fbs[frame.index] : 0;
+      if (frame.ts_sec != 0) {
+        gfx.next_flip_tag.sequence = frame.sequence;
+        gfx.next_flip_tag.capture_ns = (uint64_t)frame.ts_sec * 1000000000ull + (uint64_t)frame.ts_usec * 1000ull;
+      }
+      const uint64_t flips_before = gfx.pageflip_submitted;
+      if (fb && drm_gbm_egl_scanout_present(gfx, fb)) {
+        if (gfx.pageflip_pending) {
+          loop.arm_timer(flip_watchdog_ns);
+          flip_watchdog_armed = true;
+          flip_submit_ns = monotonic_ns();
+        }
+        if (late_latch) latch.end(monotonic_ns());
+        log_startup();
+        publish_counters();
+        if (!retire_frame(frame, true, gfx.pageflip_submitted > flips_before)) {
+          std::fprintf(stderr, "[rock5b_hdmiin_gl] release_frame failed\n");
           break;
         }
+        if (cap.backlog_pending()) {
+          capture_ready = true;
+          if (!gfx.pageflip_pending) loop.arm_timer(frame_period_ns);
+        }
         continue;
       }
+      // The plane took the test commit but not this one: render with GL from here on. The
+      // blocking commit in scanout_end() waits out the last direct flip on an overlay or the
+      // primary plane, so the held buffers can go back.
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] direct scanout failed, rendering with GL\n");
+      destroy_direct_scanout();
+      last_seen_flip_completed = gfx.pageflip_completed;
+      if (displayed_v4l2_index >= 0 && !use_zero_copy) {
+        V4L2Frame rel;
+        rel.needs_release = true;
+        rel.index = (uint32_t)displayed_v4l2_index;
+        cap.release_frame(rel);
+        displayed_v4l2_index = -1;
+      }
+      if (pending_v4l2_index >= 0) {
+        V4L2Frame rel;
+        rel.needs_release = true;
+        rel.index = (uint32_t)pending_v4l2_index;
+        cap.release_frame(rel);
+        pending_v4l2_index = -1;
+      }
+    }
+
+    const uint64_t upload_start_ns = monotonic_ns();
+
+    if (use_yuv) {
 
       if (!use_zero_copy) {
         cur_y_tex = tex_y;
         cur_uv_tex = tex_uv;
+        cur_v_tex = tex_v;
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, tex_y);
-        if (!tex_alloc || tex_w != frame.width || tex_h != frame.height) {
-          glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, (GLsizei)frame.width, (GLsizei)frame.height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, nullptr);
+        const bool realloc = !tex_alloc || tex_w != frame.width || tex_h != frame.height;
+        // GLES2 has no GL_UNPACK_ROW_LENGTH; padded planes are uploaded row by row.
+        auto upload_plane = [&](GLenum unit, GLuint t, GLenum format, uint32_t bpp, uint32_t w, uint32_t h, const uint8_t* src, uint32_t stride) {
+          glActiveTexture(unit);
+          glBindTexture(GL_TEXTURE_2D, t);
+          if (realloc) glTexImage2D(GL_TEXTURE_2D, 0, format, (GLsizei)w, (GLsizei)h, 0, format, GL_UNSIGNED_BYTE, nullptr);
+          if (stride == 0 || stride == w * bpp) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)w, (GLsizei)h, format, GL_UNSIGNED_BYTE, src);
+          } else {
+            for (uint32_t row = 0; row < h; row++) {
+              glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (GLint)row, (GLsizei)w, 1, format, GL_UNSIGNED_BYTE, src + (size_t)row * stride);
+            }
+          }
+        };
+
+        const uint32_t uv_w = chroma_w(frame.width);
+        const uint32_t uv_h = chroma_h(frame.height);
+        upload_plane(GL_TEXTURE0, tex_y, GL_LUMINANCE, 1, frame.width, frame.height, frame.plane0, frame.y_stride);
+        if (use_yuv420p) {
+          upload_plane(GL_TEXTURE1, tex_uv, GL_LUMINANCE, 1, uv_w, uv_h, frame.plane1, frame.uv_stride);
+          upload_plane(GL_TEXTURE3, tex_v, GL_LUMINANCE, 1, uv_w, uv_h, frame.plane2, frame.uv_stride);
+        } else {
+          upload_plane(GL_TEXTURE1, tex_uv, GL_LUMINANCE_ALPHA, 2, uv_w, uv_h, frame.plane1, frame.uv_stride);
+        }
+        tex_alloc = true;
+        tex_w = frame.width;
+        tex_h = frame.height;
+      } else if (frame.index >= (use_external ? yuv_texs.size() : y_texs.size())) {
+        // No EGLImage for this buffer: drawing would show the previous frame's textures.
+        std::fprintf(stderr, "[rock5b_hdmiin_gl] capture buffer %u has no imported EGLImage, skipping frame\n",
+                     (unsigned)frame.index);
+        if (!cap.release_frame(frame)) {
+          std::fprintf(stderr, "[rock5b_hdmiin_gl] release_frame failed\n");
+          break;
         }
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)frame.width, (GLsizei)frame.height, GL_LUMINANCE, GL_UNSIGNED_BYTE, frame.plane0);
+        continue;
+      } else if (use_external) {
+        cur_y_tex = yuv_texs[frame.index];
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_EXTERNAL_OES, cur_y_tex);
+      } else {
+        const uint32_t idx = frame.index;
+        cur_y_tex = y_texs[idx];
+        cur_uv_tex = uv_texs[idx];
+        cur_v_tex = use_yuv420p ? v_texs[idx] : 0;
 
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, cur_y_tex);
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, tex_uv);
+        glBindTexture(GL_TEXTURE_2D, cur_uv_tex);
+        if (cur_v_tex) {
+          glActiveTexture(GL_TEXTURE3);
+          glBindTexture(GL_TEXTURE_2D, cur_v_tex);
+        }
+      }
+    } else if (use_packed) {
+      // Packed 4:2:2 is one RGBA texel per pixel pair; BGR24 is one RGB texel per pixel.
+      const GLsizei tw = (GLsizei)(use_packed422 ? (frame.width / 2) : frame.width);
+      const GLsizei th = (GLsizei)frame.height;
+      const GLenum tex_format = use_packed422 ? GL_RGBA : GL_RGB;
+      const uint32_t row_bytes = use_packed422 ? (frame.width * 2) : (frame.width * 3);
+
+      glActiveTexture(GL_TEXTURE0);
+      if (use_zero_copy && frame.index < packed_texs.size()) {
+        cur_rgb_tex = packed_texs[frame.index];
+        glBindTexture(GL_TEXTURE_2D, cur_rgb_tex);
+      } else {
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, (row_bytes % 4 == 0) ? 4 : 1);
         if (!tex_alloc || tex_w != frame.width || tex_h != frame.height) {
-          const GLsizei uv_w = (GLsizei)(use_nv24 ? frame.width : (frame.width / 2));
-          const GLsizei uv_h = (GLsizei)(use_nv24 ? frame.height : (frame.height / 2));
-          glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, uv_w, uv_h, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, nullptr);
+          glTexImage2D(GL_TEXTURE_2D, 0, tex_format, tw, th, 0, tex_format, GL_UNSIGNED_BYTE, nullptr);
           tex_alloc = true;
           tex_w = frame.width;
           tex_h = frame.height;
         }
-        {
-          const GLsizei uv_w = (GLsizei)(use_nv24 ? frame.width : (frame.width / 2));
-          const GLsizei uv_h = (GLsizei)(use_nv24 ? frame.height : (frame.height / 2));
-          glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, uv_w, uv_h, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, frame.plane1);
-        }
-      } else {
-        if (y_images.empty()) {
-          const size_t nbuf = (size_t)cap.buffer_count();
-          y_images.assign(nbuf, EGL_NO_IMAGE_KHR);
-          uv_images.assign(nbuf, EGL_NO_IMAGE_KHR);
-          y_texs.assign(nbuf, 0);
-          uv_texs.assign(nbuf, 0);
-
-          for (size_t i = 0; i < nbuf; i++) {
-            int fd = cap.dmabuf_fd((uint32_t)i);
-            if (fd < 0) {
-              if (debug) std::fprintf(stderr, "[rock5b_hdmiin_gl] dmabuf_fd(%zu) invalid\n", i);
-              use_zero_copy = false;
-              break;
-            }
-
-            const int y_w = (int)cap.width();
-            const int y_h = (int)cap.height();
-            const int uv_w = use_nv24 ? y_w : (y_w / 2);
-            const int uv_h = use_nv24 ? y_h : (y_h / 2);
-            const int y_pitch = (int)frame.y_stride;
-            const int uv_pitch = (int)frame.uv_stride;
-            const int y_offset = 0;
-            const int uv_offset = (int)(frame.y_stride * frame.height);
-
-            const EGLint y_attr[] = {
-                EGL_WIDTH, y_w,
-                EGL_HEIGHT, y_h,
-                EGL_LINUX_DRM_FOURCC_EXT, (EGLint)DRM_FORMAT_R8,
-                EGL_DMA_BUF_PLANE0_FD_EXT, fd,
-                EGL_DMA_BUF_PLANE0_OFFSET_EXT, y_offset,
-                EGL_DMA_BUF_PLANE0_PITCH_EXT, y_pitch,
-                EGL_NONE};
-            const EGLint uv_attr[] = {
-                EGL_WIDTH, uv_w,
-                EGL_HEIGHT, uv_h,
-                EGL_LINUX_DRM_FOURCC_EXT, (EGLint)DRM_FORMAT_GR88,
-                EGL_DMA_BUF_PLANE0_FD_EXT, fd,
-                EGL_DMA_BUF_PLANE0_OFFSET_EXT, uv_offset,
-                EGL_DMA_BUF_PLANE0_PITCH_EXT, uv_pitch,
-                EGL_NONE};
-
-            y_images[i] = eglCreateImageKHR_ptr(gfx.egl_display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, (EGLClientBuffer)nullptr, y_attr);
-            uv_images[i] = eglCreateImageKHR_ptr(gfx.egl_display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, (EGLClientBuffer)nullptr, uv_attr);
-            if (y_images[i] == EGL_NO_IMAGE_KHR || uv_images[i] == EGL_NO_IMAGE_KHR) {
-              std::fprintf(stderr, "[rock5b_hdmiin_gl] eglCreateImageKHR failed (err=0x%x)\n", (unsigned)eglGetError());
-              use_zero_copy = false;
-              break;
-            }
-
-            glGenTextures(1, &y_texs[i]);
-            glBindTexture(GL_TEXTURE_2D, y_texs[i]);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glEGLImageTargetTexture2DOES_ptr(GL_TEXTURE_2D, (GLeglImageOES)y_images[i]);
-
-            glGenTextures(1, &uv_texs[i]);
-            glBindTexture(GL_TEXTURE_2D, uv_texs[i]);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glEGLImageTargetTexture2DOES_ptr(GL_TEXTURE_2D, (GLeglImageOES)uv_images[i]);
+        // GLES2 has no GL_UNPACK_ROW_LENGTH; padded strides are uploaded row by row.
+        if (frame.y_stride == row_bytes) {
+          glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tw, th, tex_format, GL_UNSIGNED_BYTE, frame.plane0);
+        } else {
+          for (GLsizei row = 0; row < th; row++) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, tw, 1, tex_format, GL_UNSIGNED_BYTE, frame.plane0 + (size_t)row * frame.y_stride);
           }
         }
-
-        if (use_zero_copy) {
-          uint32_t idx = frame.index;
-          if (idx < y_texs.size()) {
-            cur_y_tex = y_texs[idx];
-            cur_uv_tex = uv_texs[idx];
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, cur_y_tex);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, cur_uv_tex);
-          }
+        cur_rgb_tex = tex;
+        // The upload copied the pixels, so the capture buffer can go back to the driver now.
+        if (!cap.release_frame(frame)) {
+          std::fprintf(stderr, "[rock5b_hdmiin_gl] release_frame failed\n");
+          break;
         }
       }
     } else {
-      if (frame.data.empty()) continue;
+      if (!frame.data) continue;
 
       glBindTexture(GL_TEXTURE_2D, tex);
       if (!tex_alloc || tex_w != frame.width || tex_h != frame.height) {
@@ -1089,25 +1984,41 @@ int main(int argc, char** argv) {
         tex_w = frame.width;
         tex_h = frame.height;
       }
-      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)frame.width, (GLsizei)frame.height, GL_RGB, GL_UNSIGNED_BYTE, frame.data.data());
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)frame.width, (GLsizei)frame.height, GL_RGB, GL_UNSIGNED_BYTE, frame.data);
       cur_rgb_tex = tex;
+      // Hand the converted buffer back to the capture's frame pool.
+      cap.release_frame(frame);
     }
 
+    metrics.upload.observe_ns(monotonic_ns() - upload_start_ns);
+    // Drain finished queries every frame, whether it is presented by flip event, SetCrtc or
+    // without events, so the query slots never all stay busy.
+    gpu_timer.collect(metrics.gpu);
+    gpu_timer.begin();
+
     if (!two_pass) {
       glClearColor(0.f, 0.f, 0.f, 1.f);
       glClear(GL_COLOR_BUFFER_BIT);
 
       glUseProgram(prog_pre);
-      if (use_yuv) {
+      if (use_external) {
+        glActiveTexture(GL_TEXTURE0);
+        glUniform1i(u_tex_pre, 0);
+      } else if (use_yuv) {
         glActiveTexture(GL_TEXTURE0);
         glActiveTexture(GL_TEXTURE1);
         glUniform1i(u_tex_y_pre, 0);
         glUniform1i(u_tex_uv_pre, 1);
+        if (u_tex_v_pre >= 0) glUniform1i(u_tex_v_pre, 3);
         glUniform1i(u_uvSwap_pre, nv21 ? 1 : 0);
         if (u_uvRA_pre >= 0) glUniform1i(u_uvRA_pre, dmabuf_uv_ra ? 1 : 0);
       } else {
         glUniform1i(u_tex_pre, 0);
+        if (u_texSize_pre >= 0) glUniform2f(u_texSize_pre, (float)(frame.width / 2), (float)frame.height);
+        if (u_uyvy_pre >= 0) glUniform1i(u_uyvy_pre, use_uyvy ? 1 : 0);
       }
+      if (u_yuvMat_pre >= 0) glUniformMatrix3fv(u_yuvMat_pre, 1, GL_FALSE, yuv_mat.mat);
+      if (u_yuvOffset_pre >= 0) glUniform3fv(u_yuvOffset_pre, 1, yuv_mat.offset);
 
       glEnableVertexAttribArray((GLuint)a_pos_pre);
       glVertexAttribPointer((GLuint)a_pos_pre, 2, GL_FLOAT, GL_FALSE, 0, verts);
@@ -1117,8 +2028,8 @@ int main(int argc, char** argv) {
 
       glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     } else {
-      const uint32_t src_w = use_yuv ? frame.width : tex_w;
-      const uint32_t src_h = use_yuv ? frame.height : tex_h;
+      const uint32_t src_w = (use_yuv || use_packed) ? frame.width : tex_w;
+      const uint32_t src_h = (use_yuv || use_packed) ? frame.height : tex_h;
 
       if (!fbo_alloc || fbo_w != src_w || fbo_h != src_h) {
         if (fbo == 0) glGenFramebuffers(1, &fbo);
@@ -1151,11 +2062,20 @@ int main(int argc, char** argv) {
 
       glUseProgram(prog_pre);
 
-      if (use_yuv) {
+      if (use_external) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_EXTERNAL_OES, cur_y_tex);
+        glUniform1i(u_tex_pre, 0);
+      } else if (use_yuv) {
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, cur_y_tex);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, cur_uv_tex);
+        if (u_tex_v_pre >= 0) {
+          glActiveTexture(GL_TEXTURE3);
+          glBindTexture(GL_TEXTURE_2D, cur_v_tex);
+          glUniform1i(u_tex_v_pre, 3);
+        }
         glUniform1i(u_tex_y_pre, 0);
         glUniform1i(u_tex_uv_pre, 1);
         glUniform1i(u_uvSwap_pre, nv21 ? 1 : 0);
@@ -1164,7 +2084,11 @@ int main(int argc, char** argv) {
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, cur_rgb_tex);
         glUniform1i(u_tex_pre, 0);
+        if (u_texSize_pre >= 0) glUniform2f(u_texSize_pre, (float)(frame.width / 2), (float)frame.height);
+        if (u_uyvy_pre >= 0) glUniform1i(u_uyvy_pre, use_uyvy ? 1 : 0);
       }
+      if (u_yuvMat_pre >= 0) glUniformMatrix3fv(u_yuvMat_pre, 1, GL_FALSE, yuv_mat.mat);
+      if (u_yuvOffset_pre >= 0) glUniform3fv(u_yuvOffset_pre, 1, yuv_mat.offset);
 
       glEnableVertexAttribArray((GLuint)a_pos_pre);
       glVertexAttribPointer((GLuint)a_pos_pre, 2, GL_FLOAT, GL_FALSE, 0, verts);
@@ -1220,12 +2144,26 @@ int main(int argc, char** argv) {
       }
     }
 
+    gpu_timer.end();
+
     const uint64_t flips_before = gfx.pageflip_submitted;
+    if (frame.ts_sec != 0) {
+      gfx.next_flip_tag.sequence = frame.sequence;
+      gfx.next_flip_tag.capture_ns = (uint64_t)frame.ts_sec * 1000000000ull + (uint64_t)frame.ts_usec * 1000ull;
+    }
     if (!drm_gbm_egl_swap_buffers(gfx)) {
       std::fprintf(stderr, "[rock5b_hdmiin_gl] swap_buffers failed\n");
       break;
     }
     const uint64_t flips_after = gfx.pageflip_submitted;
+    if (late_latch) latch.end(monotonic_ns());
+    log_startup();
+    if (gfx.pageflip_pending) {
+      loop.arm_timer(flip_watchdog_ns);
+      flip_watchdog_armed = true;
+      flip_submit_ns = monotonic_ns();
+    }
+    publish_counters();
 
     if (dbg_early) {
       GLenum e = glGetError();
@@ -1235,46 +2173,35 @@ int main(int argc, char** argv) {
 
     glFlush();
 
-    if (frame.needs_release) {
-      if (use_zero_copy) {
-        // If DRM pageflip events are not being used (e.g. SetCrtc fallback), pageflip_completed
-        // will not advance, so we must release buffers based on successful swaps.
-        if (!gfx.pageflip_enabled || !gfx.pageflip_use_event) {
-          if (displayed_v4l2_index >= 0) {
-            V4L2Frame rel;
-            rel.needs_release = true;
-            rel.index = (uint32_t)displayed_v4l2_index;
-            if (!cap.release_frame(rel)) {
-              std::fprintf(stderr, "[rock5b_hdmiin_gl] release_frame failed\n");
-              break;
-            }
-          }
-          displayed_v4l2_index = (int)frame.index;
-          pending_v4l2_index = -1;
-        } else {
-          if (flips_after > flips_before) {
-            pending_v4l2_index = (int)frame.index;
-          } else {
-            if (displayed_v4l2_index < 0) {
-              displayed_v4l2_index = (int)frame.index;
-            } else {
-              if (!cap.release_frame(frame)) {
-                std::fprintf(stderr, "[rock5b_hdmiin_gl] release_frame failed\n");
-                break;
-              }
-            }
-          }
-        }
-      } else {
-        if (!cap.release_frame(frame)) {
-          std::fprintf(stderr, "[rock5b_hdmiin_gl] release_frame failed\n");
-          break;
-        }
-      }
+    if (frame.needs_release && !retire_frame(frame, use_zero_copy, flips_after > flips_before)) {
+      std::fprintf(stderr, "[rock5b_hdmiin_gl] release_frame failed\n");
+      break;
     }
+
+    // FIFO/paced kept frames back: take the next one after this flip lands (or after a frame
+    // period when flips complete without events).
+    if (cap.backlog_pending()) {
+      capture_ready = true;
+      if (!gfx.pageflip_pending) loop.arm_timer(frame_period_ns);
+    }
+  }
+
+  publish_counters();
+  metrics_exporter.stop();
+  std::fprintf(stderr, "[rock5b_hdmiin_gl] frame_policy=%s: %llu frames shown, %llu dropped, %llu repeated, %llu lost by the driver\n",
+               frame_policy_name(policy), (unsigned long long)frames_shown, (unsigned long long)cap.frames_dropped(),
+               (unsigned long long)frames_repeated, (unsigned long long)cap.frames_lost());
+  if (scanout_latency.count) {
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] capture->scanout latency: avg=%.2f min=%.2f max=%.2f ms over %llu flips\n",
+                 scanout_latency.avg_ms(), (double)scanout_latency.min_ns / 1e6, (double)scanout_latency.max_ns / 1e6,
+                 (unsigned long long)scanout_latency.count);
+  }
+  if (late_latch) {
+    std::fprintf(stderr, "[rock5b_hdmiin_gl] late latch: render=%.2f margin=%.2f ms, %llu missed vblanks\n",
+                 (double)latch.cost_ns() / 1e6, (double)latch.margin_ns() / 1e6, (unsigned long long)latch.misses());
   }
 
-  if (use_zero_copy) {
+  if ((use_zero_copy || use_direct) && source_active) {
     if (displayed_v4l2_index >= 0) {
       V4L2Frame rel;
       rel.needs_release = true;
@@ -1289,14 +2216,13 @@ int main(int argc, char** argv) {
     }
   }
 
+  // EGLImages hold references on the exported capture buffers; drop them before freeing those.
+  if (source_active) destroy_source_pipeline();
+
   cap.stop();
   cap.close_device();
 
-  for (size_t i = 0; i < y_images.size(); i++) {
-    if (y_images[i] != EGL_NO_IMAGE_KHR && eglDestroyImageKHR_ptr) eglDestroyImageKHR_ptr(gfx.egl_display, y_images[i]);
-    if (uv_images[i] != EGL_NO_IMAGE_KHR && eglDestroyImageKHR_ptr) eglDestroyImageKHR_ptr(gfx.egl_display, uv_images[i]);
-  }
-
+  gpu_timer.destroy();
   destroy_drm_gbm_egl(gfx);
   return 0;
 }
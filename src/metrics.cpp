@@ -0,0 +1,150 @@
+#include "metrics.h"
+
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+void LatencyHistogram::observe_ns(uint64_t ns) {
+  const uint64_t us = (ns + 999) / 1000;
+  // Smallest i with us <= 2^i.
+  int i = (us <= 1) ? 0 : 64 - __builtin_clzll(us - 1);
+  if (i > kFiniteBuckets) i = kFiniteBuckets;
+  buckets_[i].fetch_add(1, std::memory_order_relaxed);
+  sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+namespace {
+
+struct Writer {
+  char* buf;
+  size_t size;
+  size_t len = 0;
+
+  __attribute__((format(printf, 2, 3))) void put(const char* fmt, ...) {
+    if (len + 1 >= size) return;
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = std::vsnprintf(buf + len, size - len, fmt, ap);
+    va_end(ap);
+    if (n > 0) len = (len + (size_t)n < size) ? len + (size_t)n : size - 1;
+  }
+};
+
+void put_histogram(Writer& w, const char* name, const char* help, const LatencyHistogram& h) {
+  w.put("# HELP rock5b_%s_seconds %s\n# TYPE rock5b_%s_seconds histogram\n", name, help, name);
+  uint64_t cumulative = 0;
+  for (int i = 0; i < LatencyHistogram::kFiniteBuckets; i++) {
+    cumulative += h.bucket(i);
+    w.put("rock5b_%s_seconds_bucket{le=\"%.9g\"} %llu\n", name, (double)LatencyHistogram::bucket_bound_us(i) / 1e6,
+          (unsigned long long)cumulative);
+  }
+  cumulative += h.bucket(LatencyHistogram::kFiniteBuckets);
+  w.put("rock5b_%s_seconds_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+  w.put("rock5b_%s_seconds_sum %.9f\n", name, (double)h.sum_ns() / 1e9);
+  // The cumulative total, not count(): both are read without a lock and must agree.
+  w.put("rock5b_%s_seconds_count %llu\n", name, (unsigned long long)cumulative);
+}
+
+void put_counter(Writer& w, const char* name, const char* help, const std::atomic<uint64_t>& v) {
+  w.put("# HELP rock5b_%s_total %s\n# TYPE rock5b_%s_total counter\nrock5b_%s_total %llu\n", name, help, name, name,
+        (unsigned long long)v.load(std::memory_order_relaxed));
+}
+
+}  // namespace
+
+size_t format_metrics_prometheus(const Metrics& m, char* buf, size_t size) {
+  if (!buf || size == 0) return 0;
+  buf[0] = '\0';
+  Writer w{buf, size};
+  put_histogram(w, "acquire", "Time spent acquiring a capture frame.", m.acquire);
+  put_histogram(w, "upload", "CPU time spent uploading or binding frame textures.", m.upload);
+  put_histogram(w, "gpu", "GPU time spent drawing a frame.", m.gpu);
+  put_histogram(w, "flip_wait", "Page-flip submission to completion.", m.flip_wait);
+  put_histogram(w, "capture_to_scanout", "Capture timestamp to the vblank that showed the frame.", m.scanout);
+  put_counter(w, "frames_shown", "Captured frames rendered.", m.frames_shown);
+  put_counter(w, "frames_dropped", "Captured frames skipped by the frame policy or queues.", m.frames_dropped);
+  put_counter(w, "frames_repeated", "Vblanks that repeated the previous frame.", m.frames_repeated);
+  put_counter(w, "frames_lost", "Frames lost by the capture driver (V4L2 sequence gaps).", m.frames_lost);
+  put_counter(w, "flips_submitted", "Page flips submitted.", m.flips_submitted);
+  put_counter(w, "flips_completed", "Page flips completed.", m.flips_completed);
+  put_counter(w, "flips_dropped", "Frames not flipped because the display was busy.", m.flips_dropped);
+  return w.len;
+}
+
+bool MetricsExporter::start(const Metrics& m, const std::string& path, uint32_t interval_ms) {
+  stop();
+  metrics_ = &m;
+  path_ = path;
+  tmp_path_ = path + ".tmp";
+  interval_ms_ = interval_ms ? interval_ms : 1000;
+  buf_.assign(16384, '\0');
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wake_fd_ < 0) {
+    std::fprintf(stderr, "[metrics] eventfd failed: %s\n", std::strerror(errno));
+    return false;
+  }
+  if (!write_once()) {
+    ::close(wake_fd_);
+    wake_fd_ = -1;
+    return false;
+  }
+  thread_ = std::thread(&MetricsExporter::run, this);
+  std::fprintf(stderr, "[metrics] writing %s every %u ms\n", path_.c_str(), interval_ms_);
+  return true;
+}
+
+void MetricsExporter::stop() {
+  if (thread_.joinable()) {
+    const uint64_t one = 1;
+    if (::write(wake_fd_, &one, sizeof(one)) < 0) {
+      // The thread also wakes on its interval, so it exits regardless.
+    }
+    thread_.join();
+  }
+  if (wake_fd_ >= 0) ::close(wake_fd_);
+  wake_fd_ = -1;
+}
+
+void MetricsExporter::run() {
+  pthread_setname_np(pthread_self(), "metrics");
+  while (true) {
+    pollfd pfd{};
+    pfd.fd = wake_fd_;
+    pfd.events = POLLIN;
+    const int pr = poll(&pfd, 1, (int)interval_ms_);
+    write_once();
+    if (pr > 0) break;
+  }
+}
+
+bool MetricsExporter::write_once() {
+  const size_t len = format_metrics_prometheus(*metrics_, buf_.data(), buf_.size());
+  const int fd = ::open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    if (!write_failed_) std::fprintf(stderr, "[metrics] open(%s) failed: %s\n", tmp_path_.c_str(), std::strerror(errno));
+    write_failed_ = true;
+    return false;
+  }
+  size_t off = 0;
+  while (off < len) {
+    const ssize_t n = ::write(fd, buf_.data() + off, len - off);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    off += (size_t)n;
+  }
+  ::close(fd);
+  if (off != len || ::rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+    if (!write_failed_) std::fprintf(stderr, "[metrics] writing %s failed: %s\n", path_.c_str(), std::strerror(errno));
+    write_failed_ = true;
+    return false;
+  }
+  write_failed_ = false;
+  return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Durations in power-of-two microsecond buckets: <=1us, <=2us, ... <=2^20us (~1 s), then +Inf.
+// observe_ns() is lock-free and may run on any thread; readers get per-field snapshots, which
+// is all monitoring needs.
+class LatencyHistogram {
+public:
+  static constexpr int kFiniteBuckets = 21;
+  static constexpr int kBuckets = kFiniteBuckets + 1;
+
+  void observe_ns(uint64_t ns);
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t sum_ns() const { return sum_ns_.load(std::memory_order_relaxed); }
+  // Observations in bucket i alone (not cumulative).
+  uint64_t bucket(int i) const { return buckets_[i].load(std::memory_order_relaxed); }
+  static uint64_t bucket_bound_us(int i) { return 1ull << i; }
+
+private:
+  std::atomic<uint64_t> buckets_[kBuckets]{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_ns_{0};
+};
+
+// Always-on pipeline metrics. The render loop observes the histograms and mirrors its
+// counters here; an exporter reads them from another thread.
+struct Metrics {
+  LatencyHistogram acquire;    // V4L2Capture::acquire_frame()
+  LatencyHistogram upload;     // texture uploads / EGLImage binds, CPU side
+  LatencyHistogram gpu;        // draw calls, GPU side (GL_EXT_disjoint_timer_query)
+  LatencyHistogram flip_wait;  // page-flip submission to the vblank that completed it
+  LatencyHistogram scanout;    // capture timestamp to the vblank that showed the frame
+
+  std::atomic<uint64_t> frames_shown{0};
+  std::atomic<uint64_t> frames_dropped{0};   // captured but never shown (frame policy, queues)
+  std::atomic<uint64_t> frames_repeated{0};  // vblanks that showed the previous frame again
+  std::atomic<uint64_t> frames_lost{0};      // V4L2 sequence gaps
+  std::atomic<uint64_t> flips_submitted{0};
+  std::atomic<uint64_t> flips_completed{0};
+  std::atomic<uint64_t> flips_dropped{0};    // GbmEglDrm::pageflip_dropped
+};
+
+// Prometheus text exposition of `m` into buf (NUL-terminated, truncated to size). Returns the
+// length written. Does not allocate.
+size_t format_metrics_prometheus(const Metrics& m, char* buf, size_t size);
+
+// Rewrites a Prometheus text file every interval on its own thread, via a temporary file and
+// rename() so readers such as node_exporter's textfile collector never see a partial write.
+class MetricsExporter {
+public:
+  MetricsExporter() = default;
+  MetricsExporter(const MetricsExporter&) = delete;
+  MetricsExporter& operator=(const MetricsExporter&) = delete;
+  ~MetricsExporter() { stop(); }
+
+  bool start(const Metrics& m, const std::string& path, uint32_t interval_ms);
+  // Writes a final snapshot and joins the thread.
+  void stop();
+
+private:
+  void run();
+  bool write_once();
+
+  const Metrics* metrics_ = nullptr;
+  std::string path_;
+  std::string tmp_path_;
+  uint32_t interval_ms_ = 1000;
+  std::vector<char> buf_;
+  std::thread thread_;
+  int wake_fd_ = -1;
+  bool write_failed_ = false;  // log a failing path once, not every interval
+};
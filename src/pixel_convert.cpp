@@ -0,0 +1,189 @@
+#include "pixel_convert.h"
+#include "convert_pool.h"
+
+static inline uint8_t clamp_u8(int v) {
+  if (v < 0) return 0;
+  if (v > 255) return 255;
+  return static_cast<uint8_t>(v);
+}
+
+template <int CS>
+static inline void yuv_to_rgb(int Y, int U, int V, uint8_t* rgb) {
+  // 8.8 fixed-point conversion; the SIMD kernels must stay bit-exact with this.
+  constexpr YuvFixedCoeffs K = kYuvFixedCoeffs<CS>;
+  Y -= K.y_offset;
+  U -= 128;
+  V -= 128;
+  if (Y < 0) Y = 0;
+  int C = K.y * Y;
+  rgb[0] = clamp_u8((C + K.rv * V + 128) >> 8);
+  rgb[1] = clamp_u8((C - K.gu * U - K.gv * V + 128) >> 8);
+  rgb[2] = clamp_u8((C + K.bu * U + 128) >> 8);
+}
+
+template <int CS>
+static void nv12_row_scalar(const uint8_t* y, const uint8_t* uv, uint8_t* rgb, uint32_t width, bool uv_swap) {
+  const uint32_t ui = uv_swap ? 1 : 0;
+  const uint32_t vi = uv_swap ? 0 : 1;
+  for (uint32_t x = 0; x < width; x++) {
+    const uint32_t c = x & ~1u;
+    yuv_to_rgb<CS>((int)y[x], (int)uv[c + ui], (int)uv[c + vi], rgb + (size_t)x * 3);
+  }
+}
+
+template <int CS>
+static void nv24_row_scalar(const uint8_t* y, const uint8_t* uv, uint8_t* rgb, uint32_t width, bool uv_swap) {
+  const uint32_t ui = uv_swap ? 1 : 0;
+  const uint32_t vi = uv_swap ? 0 : 1;
+  for (uint32_t x = 0; x < width; x++) {
+    yuv_to_rgb<CS>((int)y[x], (int)uv[x * 2 + ui], (int)uv[x * 2 + vi], rgb + (size_t)x * 3);
+  }
+}
+
+template <int CS>
+static void yuyv_row_scalar(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  for (uint32_t x = 0; x < width; x += 2) {
+    const uint8_t* p = src + (size_t)x * 2;
+    yuv_to_rgb<CS>((int)p[0], (int)p[1], (int)p[3], rgb + (size_t)x * 3);
+    if (x + 1 < width) yuv_to_rgb<CS>((int)p[2], (int)p[1], (int)p[3], rgb + (size_t)(x + 1) * 3);
+  }
+}
+
+template <int CS>
+static void uyvy_row_scalar(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  for (uint32_t x = 0; x < width; x += 2) {
+    const uint8_t* p = src + (size_t)x * 2;
+    yuv_to_rgb<CS>((int)p[1], (int)p[0], (int)p[2], rgb + (size_t)x * 3);
+    if (x + 1 < width) yuv_to_rgb<CS>((int)p[3], (int)p[0], (int)p[2], rgb + (size_t)(x + 1) * 3);
+  }
+}
+
+static void bgr24_row_scalar(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  for (uint32_t x = 0; x < width; x++) {
+    rgb[x * 3 + 0] = src[x * 3 + 2];
+    rgb[x * 3 + 1] = src[x * 3 + 1];
+    rgb[x * 3 + 2] = src[x * 3 + 0];
+  }
+}
+
+static constexpr auto kScalarKernels = make_kernel_table([](auto cs) {
+  constexpr int CS = decltype(cs)::value;
+  return ConvertKernels{
+      "scalar",
+      nv12_row_scalar<CS>,
+      nv24_row_scalar<CS>,
+      yuyv_row_scalar<CS>,
+      uyvy_row_scalar<CS>,
+      bgr24_row_scalar,
+  };
+});
+
+const ConvertKernels& convert_kernels_scalar(Colorimetry cs) {
+  return kScalarKernels[colorimetry_index(cs)];
+}
+
+using KernelSetFn = const ConvertKernels* (*)(Colorimetry);
+
+static KernelSetFn pick_convert_kernels() {
+  if (convert_kernels_neon()) return convert_kernels_neon;
+  if (convert_kernels_avx2()) return convert_kernels_avx2;
+  if (convert_kernels_ssse3()) return convert_kernels_ssse3;
+  return [](Colorimetry cs) { return &convert_kernels_scalar(cs); };
+}
+
+const ConvertKernels& convert_kernels(Colorimetry cs) {
+  static const KernelSetFn pick = pick_convert_kernels();
+  return *pick(cs);
+}
+
+bool bgr24_to_rgb24(const uint8_t* bgr, uint32_t width, uint32_t height, uint8_t* rgb_out, ConvertPool* pool) {
+  if (!bgr || !rgb_out || width == 0 || height == 0) return false;
+  const ConvertKernels& k = convert_kernels();
+  const size_t row_bytes = static_cast<size_t>(width) * 3;
+  uint8_t* dst = rgb_out;
+  convert_rows(pool, height, [&](uint32_t y) {
+    k.bgr24_row(bgr + y * row_bytes, dst + y * row_bytes, width);
+  });
+  return true;
+}
+
+bool nv12_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height, uint32_t y_stride, uint32_t uv_stride, bool uv_swap, Colorimetry cs, uint8_t* rgb_out, ConvertPool* pool) {
+  if (!y_plane || !uv_plane || !rgb_out || width == 0 || height == 0) return false;
+  if (y_stride == 0) y_stride = width;
+  if (uv_stride == 0) uv_stride = y_stride;
+
+  const ConvertKernels& k = convert_kernels(cs);
+  uint8_t* dst = rgb_out;
+  convert_rows(pool, height, [&](uint32_t y) {
+    k.nv12_row(y_plane + static_cast<size_t>(y) * y_stride,
+               uv_plane + static_cast<size_t>(y / 2) * uv_stride,
+               dst + static_cast<size_t>(y) * width * 3,
+               width, uv_swap);
+  });
+  return true;
+}
+
+bool nv24_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height,
+                   uint32_t y_stride, uint32_t uv_stride, bool uv_swap, Colorimetry cs, uint8_t* rgb_out, ConvertPool* pool) {
+  if (!y_plane || !uv_plane || !rgb_out || width == 0 || height == 0) return false;
+  if (y_stride == 0) y_stride = width;
+  // NV24 is 4:4:4 with interleaved UV for every pixel: 2 bytes per pixel in UV plane.
+  if (uv_stride == 0) uv_stride = width * 2;
+
+  const ConvertKernels& k = convert_kernels(cs);
+  uint8_t* dst = rgb_out;
+  convert_rows(pool, height, [&](uint32_t y) {
+    k.nv24_row(y_plane + static_cast<size_t>(y) * y_stride,
+               uv_plane + static_cast<size_t>(y) * uv_stride,
+               dst + static_cast<size_t>(y) * width * 3,
+               width, uv_swap);
+  });
+  return true;
+}
+
+bool yuyv_to_rgb24(const uint8_t* src, uint32_t width, uint32_t height, uint32_t stride, Colorimetry cs, uint8_t* rgb_out, ConvertPool* pool) {
+  if (!src || !rgb_out || width == 0 || height == 0) return false;
+  if (stride == 0) stride = width * 2;
+  const ConvertKernels& k = convert_kernels(cs);
+  uint8_t* dst = rgb_out;
+  convert_rows(pool, height, [&](uint32_t y) {
+    k.yuyv_row(src + static_cast<size_t>(y) * stride, dst + static_cast<size_t>(y) * width * 3, width);
+  });
+  return true;
+}
+
+bool uyvy_to_rgb24(const uint8_t* src, uint32_t width, uint32_t height, uint32_t stride, Colorimetry cs, uint8_t* rgb_out, ConvertPool* pool) {
+  if (!src || !rgb_out || width == 0 || height == 0) return false;
+  if (stride == 0) stride = width * 2;
+  const ConvertKernels& k = convert_kernels(cs);
+  uint8_t* dst = rgb_out;
+  convert_rows(pool, height, [&](uint32_t y) {
+    k.uyvy_row(src + static_cast<size_t>(y) * stride, dst + static_cast<size_t>(y) * width * 3, width);
+  });
+  return true;
+}
+
+static uint8_t* resize_rgb(std::vector<uint8_t>& rgb_out, uint32_t width, uint32_t height) {
+  rgb_out.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 3);
+  return rgb_out.data();
+}
+
+bool bgr24_to_rgb24(const uint8_t* bgr, uint32_t width, uint32_t height, std::vector<uint8_t>& rgb_out, ConvertPool* pool) {
+  return bgr24_to_rgb24(bgr, width, height, resize_rgb(rgb_out, width, height), pool);
+}
+
+bool nv12_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height, uint32_t y_stride, uint32_t uv_stride, bool uv_swap, Colorimetry cs, std::vector<uint8_t>& rgb_out, ConvertPool* pool) {
+  return nv12_to_rgb24(y_plane, uv_plane, width, height, y_stride, uv_stride, uv_swap, cs, resize_rgb(rgb_out, width, height), pool);
+}
+
+bool nv24_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height, uint32_t y_stride, uint32_t uv_stride, bool uv_swap, Colorimetry cs, std::vector<uint8_t>& rgb_out, ConvertPool* pool) {
+  return nv24_to_rgb24(y_plane, uv_plane, width, height, y_stride, uv_stride, uv_swap, cs, resize_rgb(rgb_out, width, height), pool);
+}
+
+bool yuyv_to_rgb24(const uint8_t* src, uint32_t width, uint32_t height, uint32_t stride, Colorimetry cs, std::vector<uint8_t>& rgb_out, ConvertPool* pool) {
+  return yuyv_to_rgb24(src, width, height, stride, cs, resize_rgb(rgb_out, width, height), pool);
+}
+
+bool uyvy_to_rgb24(const uint8_t* src, uint32_t width, uint32_t height, uint32_t stride, Colorimetry cs, std::vector<uint8_t>& rgb_out, ConvertPool* pool) {
+  return uyvy_to_rgb24(src, width, height, stride, cs, resize_rgb(rgb_out, width, height), pool);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "colorimetry.h"
+
+class ConvertPool;
+
+// Row kernels used by the CPU conversion paths. Every kernel converts one row of `width` pixels
+// into packed RGB24 using the 8.8 fixed-point math of the scalar reference. There is one kernel
+// set per Colorimetry, with the matrix baked in as compile-time constants.
+struct ConvertKernels {
+  const char* name = nullptr;
+  void (*nv12_row)(const uint8_t* y, const uint8_t* uv, uint8_t* rgb, uint32_t width, bool uv_swap) = nullptr;
+  void (*nv24_row)(const uint8_t* y, const uint8_t* uv, uint8_t* rgb, uint32_t width, bool uv_swap) = nullptr;
+  void (*yuyv_row)(const uint8_t* src, uint8_t* rgb, uint32_t width) = nullptr;
+  void (*uyvy_row)(const uint8_t* src, uint8_t* rgb, uint32_t width) = nullptr;
+  void (*bgr24_row)(const uint8_t* src, uint8_t* rgb, uint32_t width) = nullptr;
+};
+
+// Kernel set picked for the running CPU (NEON on ARM, AVX2/SSSE3 on x86, scalar otherwise).
+// The ISA is chosen once on first use.
+const ConvertKernels& convert_kernels(Colorimetry cs = {});
+
+// Per-ISA kernel sets; return nullptr when not built for this architecture.
+const ConvertKernels& convert_kernels_scalar(Colorimetry cs = {});
+const ConvertKernels* convert_kernels_neon(Colorimetry cs = {});
+const ConvertKernels* convert_kernels_ssse3(Colorimetry cs = {});
+const ConvertKernels* convert_kernels_avx2(Colorimetry cs = {});
+
+// Builds the per-colorimetry table of an ISA from `make(std::integral_constant<int, CS>)`.
+template <typename Make, int... CS>
+constexpr std::array<ConvertKernels, kColorimetryCount> make_kernel_table(Make make, std::integer_sequence<int, CS...>) {
+  return {make(std::integral_constant<int, CS>{})...};
+}
+
+template <typename Make>
+constexpr std::array<ConvertKernels, kColorimetryCount> make_kernel_table(Make make) {
+  return make_kernel_table(make, std::make_integer_sequence<int, kColorimetryCount>{});
+}
+
+// Whole-frame converters to tightly packed RGB24 in a caller-provided width*height*3 buffer.
+// With a running pool the rows are converted in parallel stripes and the call returns once the
+// whole frame is done.
+bool bgr24_to_rgb24(const uint8_t* bgr, uint32_t width, uint32_t height, uint8_t* rgb_out, ConvertPool* pool = nullptr);
+bool nv12_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height, uint32_t y_stride, uint32_t uv_stride, bool uv_swap, Colorimetry cs, uint8_t* rgb_out, ConvertPool* pool = nullptr);
+bool nv24_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height, uint32_t y_stride, uint32_t uv_stride, bool uv_swap, Colorimetry cs, uint8_t* rgb_out, ConvertPool* pool = nullptr);
+bool yuyv_to_rgb24(const uint8_t* src, uint32_t width, uint32_t height, uint32_t stride, Colorimetry cs, uint8_t* rgb_out, ConvertPool* pool = nullptr);
+bool uyvy_to_rgb24(const uint8_t* src, uint32_t width, uint32_t height, uint32_t stride, Colorimetry cs, uint8_t* rgb_out, ConvertPool* pool = nullptr);
+
+// Same, resizing rgb_out to fit.
+bool bgr24_to_rgb24(const uint8_t* bgr, uint32_t width, uint32_t height, std::vector<uint8_t>& rgb_out, ConvertPool* pool = nullptr);
+bool nv12_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height, uint32_t y_stride, uint32_t uv_stride, bool uv_swap, Colorimetry cs, std::vector<uint8_t>& rgb_out, ConvertPool* pool = nullptr);
+bool nv24_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height, uint32_t y_stride, uint32_t uv_stride, bool uv_swap, Colorimetry cs, std::vector<uint8_t>& rgb_out, ConvertPool* pool = nullptr);
+bool yuyv_to_rgb24(const uint8_t* src, uint32_t width, uint32_t height, uint32_t stride, Colorimetry cs, std::vector<uint8_t>& rgb_out, ConvertPool* pool = nullptr);
+bool uyvy_to_rgb24(const uint8_t* src, uint32_t width, uint32_t height, uint32_t stride, Colorimetry cs, std::vector<uint8_t>& rgb_out, ConvertPool* pool = nullptr);
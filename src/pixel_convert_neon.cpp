@@ -0,0 +1,134 @@
+#include "pixel_convert.h"
+
+#if defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+namespace {
+
+// One channel for 8 pixels: (c + a * ka + b * kb + 128) >> 8, saturated to [0, 255].
+// vrshrn_n_s32 is exactly the scalar (x + 128) >> 8; the result always fits in int16.
+inline uint8x8_t channel8(int32x4_t c_lo, int32x4_t c_hi, int16x8_t a, int16_t ka, int16x8_t b, int16_t kb) {
+  int32x4_t lo = vmlal_n_s16(c_lo, vget_low_s16(a), ka);
+  int32x4_t hi = vmlal_n_s16(c_hi, vget_high_s16(a), ka);
+  if (kb != 0) {
+    lo = vmlal_n_s16(lo, vget_low_s16(b), kb);
+    hi = vmlal_n_s16(hi, vget_high_s16(b), kb);
+  }
+  return vqmovun_s16(vcombine_s16(vrshrn_n_s32(lo, 8), vrshrn_n_s32(hi, 8)));
+}
+
+template <int CS>
+inline void yuv8_to_rgb(uint8x8_t y8, uint8x8_t u8, uint8x8_t v8, uint8x8x3_t& out) {
+  constexpr YuvFixedCoeffs K = kYuvFixedCoeffs<CS>;
+  const int16x8_t y = vreinterpretq_s16_u16(vmovl_u8(vqsub_u8(y8, vdup_n_u8((uint8_t)K.y_offset))));
+  const int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), vdupq_n_s16(128));
+  const int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), vdupq_n_s16(128));
+  const int32x4_t c_lo = vmull_n_s16(vget_low_s16(y), K.y);
+  const int32x4_t c_hi = vmull_n_s16(vget_high_s16(y), K.y);
+  out.val[0] = channel8(c_lo, c_hi, v, K.rv, v, 0);
+  out.val[1] = channel8(c_lo, c_hi, u, -K.gu, v, -K.gv);
+  out.val[2] = channel8(c_lo, c_hi, u, K.bu, u, 0);
+}
+
+// Converts 16 pixels given as planar Y, U, V bytes and writes 48 bytes of RGB24.
+template <int CS>
+inline void yuv16_to_rgb(uint8x16_t y, uint8x16_t u, uint8x16_t v, uint8_t* dst) {
+  uint8x8x3_t lo, hi;
+  yuv8_to_rgb<CS>(vget_low_u8(y), vget_low_u8(u), vget_low_u8(v), lo);
+  yuv8_to_rgb<CS>(vget_high_u8(y), vget_high_u8(u), vget_high_u8(v), hi);
+  uint8x16x3_t rgb;
+  rgb.val[0] = vcombine_u8(lo.val[0], hi.val[0]);
+  rgb.val[1] = vcombine_u8(lo.val[1], hi.val[1]);
+  rgb.val[2] = vcombine_u8(lo.val[2], hi.val[2]);
+  vst3q_u8(dst, rgb);
+}
+
+inline uint8x16_t dup_each(uint8x8_t c) {
+  const uint8x8x2_t z = vzip_u8(c, c);
+  return vcombine_u8(z.val[0], z.val[1]);
+}
+
+// Row drivers: vector body over 16-pixel blocks, scalar reference for the tail.
+// x stays even at the tail so chroma pairing matches the scalar kernels.
+
+template <int CS>
+void nv12_row_neon(const uint8_t* y, const uint8_t* uv, uint8_t* rgb, uint32_t width, bool uv_swap) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const uint8x8x2_t c = vld2_u8(uv + x);
+    const uint8x16_t u = dup_each(c.val[uv_swap ? 1 : 0]);
+    const uint8x16_t v = dup_each(c.val[uv_swap ? 0 : 1]);
+    yuv16_to_rgb<CS>(vld1q_u8(y + x), u, v, rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).nv12_row(y + x, uv + x, rgb + (size_t)x * 3, width - x, uv_swap);
+}
+
+template <int CS>
+void nv24_row_neon(const uint8_t* y, const uint8_t* uv, uint8_t* rgb, uint32_t width, bool uv_swap) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const uint8x16x2_t c = vld2q_u8(uv + (size_t)x * 2);
+    yuv16_to_rgb<CS>(vld1q_u8(y + x), c.val[uv_swap ? 1 : 0], c.val[uv_swap ? 0 : 1], rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).nv24_row(y + x, uv + (size_t)x * 2, rgb + (size_t)x * 3, width - x, uv_swap);
+}
+
+template <int CS>
+void yuyv_row_neon(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    // val[0]=Y0 val[1]=U val[2]=Y1 val[3]=V for 8 pixel pairs.
+    const uint8x8x4_t p = vld4_u8(src + (size_t)x * 2);
+    const uint8x8x2_t yy = vzip_u8(p.val[0], p.val[2]);
+    yuv16_to_rgb<CS>(vcombine_u8(yy.val[0], yy.val[1]), dup_each(p.val[1]), dup_each(p.val[3]), rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).yuyv_row(src + (size_t)x * 2, rgb + (size_t)x * 3, width - x);
+}
+
+template <int CS>
+void uyvy_row_neon(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    // val[0]=U val[1]=Y0 val[2]=V val[3]=Y1 for 8 pixel pairs.
+    const uint8x8x4_t p = vld4_u8(src + (size_t)x * 2);
+    const uint8x8x2_t yy = vzip_u8(p.val[1], p.val[3]);
+    yuv16_to_rgb<CS>(vcombine_u8(yy.val[0], yy.val[1]), dup_each(p.val[0]), dup_each(p.val[2]), rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).uyvy_row(src + (size_t)x * 2, rgb + (size_t)x * 3, width - x);
+}
+
+void bgr24_row_neon(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    uint8x16x3_t p = vld3q_u8(src + (size_t)x * 3);
+    const uint8x16_t b = p.val[0];
+    p.val[0] = p.val[2];
+    p.val[2] = b;
+    vst3q_u8(rgb + (size_t)x * 3, p);
+  }
+  if (x < width) convert_kernels_scalar().bgr24_row(src + (size_t)x * 3, rgb + (size_t)x * 3, width - x);
+}
+
+}  // namespace
+
+const ConvertKernels* convert_kernels_neon(Colorimetry cs) {
+  static constexpr auto k = make_kernel_table([](auto c) {
+    constexpr int CS = decltype(c)::value;
+    return ConvertKernels{
+        "neon",
+        nv12_row_neon<CS>,
+        nv24_row_neon<CS>,
+        yuyv_row_neon<CS>,
+        uyvy_row_neon<CS>,
+        bgr24_row_neon,
+    };
+  });
+  return &k[colorimetry_index(cs)];
+}
+
+#else
+
+const ConvertKernels* convert_kernels_neon(Colorimetry) { return nullptr; }
+
+#endif
@@ -0,0 +1,330 @@
+#include "pixel_convert.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <array>
+#include <immintrin.h>
+
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace {
+
+constexpr uint8_t Z = 0x80;  // pshufb: zero this byte
+
+// pshufb masks that scatter 16 R, G, B bytes into 48 bytes of packed RGB24.
+// kRgbMask[block][channel] selects the bytes of `channel` that land in output block `block`.
+constexpr std::array<std::array<std::array<uint8_t, 16>, 3>, 3> make_rgb_masks() {
+  std::array<std::array<std::array<uint8_t, 16>, 3>, 3> m{};
+  for (int block = 0; block < 3; block++) {
+    for (int ch = 0; ch < 3; ch++) {
+      for (int j = 0; j < 16; j++) {
+        const int idx = block * 16 + j;
+        m[block][ch][j] = (idx % 3 == ch) ? (uint8_t)(idx / 3) : Z;
+      }
+    }
+  }
+  return m;
+}
+
+alignas(16) constexpr auto kRgbMask = make_rgb_masks();
+
+alignas(16) constexpr uint8_t kDupEven[16] = {0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14};
+alignas(16) constexpr uint8_t kDupOdd[16] = {1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15};
+alignas(16) constexpr uint8_t kEvenLo[16] = {0, 2, 4, 6, 8, 10, 12, 14, Z, Z, Z, Z, Z, Z, Z, Z};
+alignas(16) constexpr uint8_t kEvenHi[16] = {Z, Z, Z, Z, Z, Z, Z, Z, 0, 2, 4, 6, 8, 10, 12, 14};
+alignas(16) constexpr uint8_t kOddLo[16] = {1, 3, 5, 7, 9, 11, 13, 15, Z, Z, Z, Z, Z, Z, Z, Z};
+alignas(16) constexpr uint8_t kOddHi[16] = {Z, Z, Z, Z, Z, Z, Z, Z, 1, 3, 5, 7, 9, 11, 13, 15};
+// Packed 4:2:2, 8 pixels per 16 bytes: chroma byte at offset `o` of every 4-byte group, duplicated.
+alignas(16) constexpr uint8_t kQuad0Lo[16] = {0, 0, 4, 4, 8, 8, 12, 12, Z, Z, Z, Z, Z, Z, Z, Z};
+alignas(16) constexpr uint8_t kQuad0Hi[16] = {Z, Z, Z, Z, Z, Z, Z, Z, 0, 0, 4, 4, 8, 8, 12, 12};
+alignas(16) constexpr uint8_t kQuad1Lo[16] = {1, 1, 5, 5, 9, 9, 13, 13, Z, Z, Z, Z, Z, Z, Z, Z};
+alignas(16) constexpr uint8_t kQuad1Hi[16] = {Z, Z, Z, Z, Z, Z, Z, Z, 1, 1, 5, 5, 9, 9, 13, 13};
+alignas(16) constexpr uint8_t kQuad2Lo[16] = {2, 2, 6, 6, 10, 10, 14, 14, Z, Z, Z, Z, Z, Z, Z, Z};
+alignas(16) constexpr uint8_t kQuad2Hi[16] = {Z, Z, Z, Z, Z, Z, Z, Z, 2, 2, 6, 6, 10, 10, 14, 14};
+alignas(16) constexpr uint8_t kQuad3Lo[16] = {3, 3, 7, 7, 11, 11, 15, 15, Z, Z, Z, Z, Z, Z, Z, Z};
+alignas(16) constexpr uint8_t kQuad3Hi[16] = {Z, Z, Z, Z, Z, Z, Z, Z, 3, 3, 7, 7, 11, 11, 15, 15};
+// Swap B and R inside each of the first four 3-byte pixels of a 16-byte load.
+alignas(16) constexpr uint8_t kBgrSwap[16] = {2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15};
+
+TARGET_SSSE3 inline __m128i load_mask(const uint8_t* m) {
+  return _mm_load_si128(reinterpret_cast<const __m128i*>(m));
+}
+
+TARGET_SSSE3 inline __m128i loadu(const uint8_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// Gathers two 16-byte loads into one vector through a Lo/Hi mask pair.
+TARGET_SSSE3 inline __m128i gather2(__m128i a, __m128i b, const uint8_t* lo, const uint8_t* hi) {
+  return _mm_or_si128(_mm_shuffle_epi8(a, load_mask(lo)), _mm_shuffle_epi8(b, load_mask(hi)));
+}
+
+TARGET_SSSE3 inline void store_rgb48(__m128i r, __m128i g, __m128i b, uint8_t* dst) {
+  for (int block = 0; block < 3; block++) {
+    __m128i out = _mm_shuffle_epi8(r, load_mask(kRgbMask[block][0].data()));
+    out = _mm_or_si128(out, _mm_shuffle_epi8(g, load_mask(kRgbMask[block][1].data())));
+    out = _mm_or_si128(out, _mm_shuffle_epi8(b, load_mask(kRgbMask[block][2].data())));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + block * 16), out);
+  }
+}
+
+// 8 pixels of one channel: (madd(a, k) + extra) >> 8, saturated to int16. `extra` carries the
+// +128 rounding term, or for G the V contribution with the rounding folded in via a constant-one lane.
+TARGET_SSSE3 inline __m128i channel8_sse(__m128i a_lo, __m128i a_hi, __m128i k, __m128i extra_lo, __m128i extra_hi) {
+  const __m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(a_lo, k), extra_lo), 8);
+  const __m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(a_hi, k), extra_hi), 8);
+  return _mm_packs_epi32(lo, hi);
+}
+
+// Pair of int16 coefficients (lo, hi) as one int32 lane for madd.
+constexpr int pair16(int lo, int hi) {
+  return (int)(((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo);
+}
+
+// Converts 16 pixels given as planar Y, U, V bytes and writes 48 bytes of RGB24.
+template <int CS>
+TARGET_SSSE3 inline void yuv16_to_rgb_ssse3(__m128i y8, __m128i u8, __m128i v8, uint8_t* dst) {
+  constexpr YuvFixedCoeffs K = kYuvFixedCoeffs<CS>;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i c128 = _mm_set1_epi16(128);
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i k_r = _mm_set1_epi32(pair16(K.y, K.rv));
+  const __m128i k_gu = _mm_set1_epi32(pair16(K.y, -K.gu));
+  const __m128i k_gv = _mm_set1_epi32(pair16(-K.gv, 128));
+  const __m128i k_b = _mm_set1_epi32(pair16(K.y, K.bu));
+  const __m128i rnd = _mm_set1_epi32(128);
+
+  // max(Y - y_offset, 0) in one saturating subtract.
+  const __m128i ys = _mm_subs_epu8(y8, _mm_set1_epi8((char)K.y_offset));
+
+  __m128i out[3][2];
+  for (int half = 0; half < 2; half++) {
+    const __m128i y16 = half ? _mm_unpackhi_epi8(ys, zero) : _mm_unpacklo_epi8(ys, zero);
+    const __m128i u16 = _mm_sub_epi16(half ? _mm_unpackhi_epi8(u8, zero) : _mm_unpacklo_epi8(u8, zero), c128);
+    const __m128i v16 = _mm_sub_epi16(half ? _mm_unpackhi_epi8(v8, zero) : _mm_unpacklo_epi8(v8, zero), c128);
+
+    const __m128i yv_lo = _mm_unpacklo_epi16(y16, v16);
+    const __m128i yv_hi = _mm_unpackhi_epi16(y16, v16);
+    const __m128i yu_lo = _mm_unpacklo_epi16(y16, u16);
+    const __m128i yu_hi = _mm_unpackhi_epi16(y16, u16);
+    const __m128i v1_lo = _mm_madd_epi16(_mm_unpacklo_epi16(v16, one), k_gv);
+    const __m128i v1_hi = _mm_madd_epi16(_mm_unpackhi_epi16(v16, one), k_gv);
+
+    out[0][half] = channel8_sse(yv_lo, yv_hi, k_r, rnd, rnd);
+    out[1][half] = channel8_sse(yu_lo, yu_hi, k_gu, v1_lo, v1_hi);
+    out[2][half] = channel8_sse(yu_lo, yu_hi, k_b, rnd, rnd);
+  }
+
+  store_rgb48(_mm_packus_epi16(out[0][0], out[0][1]),
+              _mm_packus_epi16(out[1][0], out[1][1]),
+              _mm_packus_epi16(out[2][0], out[2][1]),
+              dst);
+}
+
+TARGET_AVX2 inline __m256i channel16_avx2(__m256i a_lo, __m256i a_hi, __m256i k, __m256i extra_lo, __m256i extra_hi) {
+  const __m256i lo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(a_lo, k), extra_lo), 8);
+  const __m256i hi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(a_hi, k), extra_hi), 8);
+  return _mm256_packs_epi32(lo, hi);
+}
+
+// Same as yuv16_to_rgb_ssse3 but with the multiply-add stage on 256-bit vectors.
+template <int CS>
+TARGET_AVX2 inline void yuv16_to_rgb_avx2(__m128i y8, __m128i u8, __m128i v8, uint8_t* dst) {
+  constexpr YuvFixedCoeffs K = kYuvFixedCoeffs<CS>;
+  const __m256i c128 = _mm256_set1_epi16(128);
+  const __m256i one = _mm256_set1_epi16(1);
+  const __m256i k_r = _mm256_set1_epi32(pair16(K.y, K.rv));
+  const __m256i k_gu = _mm256_set1_epi32(pair16(K.y, -K.gu));
+  const __m256i k_gv = _mm256_set1_epi32(pair16(-K.gv, 128));
+  const __m256i k_b = _mm256_set1_epi32(pair16(K.y, K.bu));
+  const __m256i rnd = _mm256_set1_epi32(128);
+
+  const __m256i y16 = _mm256_cvtepu8_epi16(_mm_subs_epu8(y8, _mm_set1_epi8((char)K.y_offset)));
+  const __m256i u16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(u8), c128);
+  const __m256i v16 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(v8), c128);
+
+  // unpack/madd/packs all work within 128-bit lanes, so the pixel order survives the round trip.
+  const __m256i yv_lo = _mm256_unpacklo_epi16(y16, v16);
+  const __m256i yv_hi = _mm256_unpackhi_epi16(y16, v16);
+  const __m256i yu_lo = _mm256_unpacklo_epi16(y16, u16);
+  const __m256i yu_hi = _mm256_unpackhi_epi16(y16, u16);
+  const __m256i v1_lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(v16, one), k_gv);
+  const __m256i v1_hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(v16, one), k_gv);
+
+  const __m256i r = channel16_avx2(yv_lo, yv_hi, k_r, rnd, rnd);
+  const __m256i g = channel16_avx2(yu_lo, yu_hi, k_gu, v1_lo, v1_hi);
+  const __m256i b = channel16_avx2(yu_lo, yu_hi, k_b, rnd, rnd);
+
+  // packus interleaves lanes as [r0-7 g0-7 | r8-15 g8-15]; permute to [r0-15 | g0-15].
+  const __m256i rg = _mm256_permute4x64_epi64(_mm256_packus_epi16(r, g), 0xD8);
+  const __m256i bb = _mm256_permute4x64_epi64(_mm256_packus_epi16(b, b), 0xD8);
+  store_rgb48(_mm256_castsi256_si128(rg), _mm256_extracti128_si256(rg, 1), _mm256_castsi256_si128(bb), dst);
+}
+
+// 16 pixels of planar Y, U, V deinterleaved from the source layouts.
+struct Yuv16 {
+  __m128i y, u, v;
+};
+
+TARGET_SSSE3 inline Yuv16 load_nv12(const uint8_t* y, const uint8_t* uv, bool uv_swap) {
+  const __m128i c = loadu(uv);
+  const __m128i even = _mm_shuffle_epi8(c, load_mask(kDupEven));
+  const __m128i odd = _mm_shuffle_epi8(c, load_mask(kDupOdd));
+  return {loadu(y), uv_swap ? odd : even, uv_swap ? even : odd};
+}
+
+TARGET_SSSE3 inline Yuv16 load_nv24(const uint8_t* y, const uint8_t* uv, bool uv_swap) {
+  const __m128i c0 = loadu(uv);
+  const __m128i c1 = loadu(uv + 16);
+  const __m128i even = gather2(c0, c1, kEvenLo, kEvenHi);
+  const __m128i odd = gather2(c0, c1, kOddLo, kOddHi);
+  return {loadu(y), uv_swap ? odd : even, uv_swap ? even : odd};
+}
+
+TARGET_SSSE3 inline Yuv16 load_yuyv(const uint8_t* src) {
+  const __m128i s0 = loadu(src);
+  const __m128i s1 = loadu(src + 16);
+  return {gather2(s0, s1, kEvenLo, kEvenHi), gather2(s0, s1, kQuad1Lo, kQuad1Hi), gather2(s0, s1, kQuad3Lo, kQuad3Hi)};
+}
+
+TARGET_SSSE3 inline Yuv16 load_uyvy(const uint8_t* src) {
+  const __m128i s0 = loadu(src);
+  const __m128i s1 = loadu(src + 16);
+  return {gather2(s0, s1, kOddLo, kOddHi), gather2(s0, s1, kQuad0Lo, kQuad0Hi), gather2(s0, s1, kQuad2Lo, kQuad2Hi)};
+}
+
+// Row drivers: vector body over 16-pixel blocks, scalar reference for the tail.
+// x stays even at the tail so chroma pairing matches the scalar kernels.
+
+template <int CS>
+TARGET_SSSE3 void nv12_row_ssse3(const uint8_t* y, const uint8_t* uv, uint8_t* rgb, uint32_t width, bool uv_swap) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const Yuv16 p = load_nv12(y + x, uv + x, uv_swap);
+    yuv16_to_rgb_ssse3<CS>(p.y, p.u, p.v, rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).nv12_row(y + x, uv + x, rgb + (size_t)x * 3, width - x, uv_swap);
+}
+
+template <int CS>
+TARGET_SSSE3 void nv24_row_ssse3(const uint8_t* y, const uint8_t* uv, uint8_t* rgb, uint32_t width, bool uv_swap) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const Yuv16 p = load_nv24(y + x, uv + (size_t)x * 2, uv_swap);
+    yuv16_to_rgb_ssse3<CS>(p.y, p.u, p.v, rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).nv24_row(y + x, uv + (size_t)x * 2, rgb + (size_t)x * 3, width - x, uv_swap);
+}
+
+template <int CS>
+TARGET_SSSE3 void yuyv_row_ssse3(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const Yuv16 p = load_yuyv(src + (size_t)x * 2);
+    yuv16_to_rgb_ssse3<CS>(p.y, p.u, p.v, rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).yuyv_row(src + (size_t)x * 2, rgb + (size_t)x * 3, width - x);
+}
+
+template <int CS>
+TARGET_SSSE3 void uyvy_row_ssse3(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const Yuv16 p = load_uyvy(src + (size_t)x * 2);
+    yuv16_to_rgb_ssse3<CS>(p.y, p.u, p.v, rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).uyvy_row(src + (size_t)x * 2, rgb + (size_t)x * 3, width - x);
+}
+
+TARGET_SSSE3 void bgr24_row_ssse3(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  // 4 pixels per step; the 16-byte load/store overruns by 4 bytes, which the next step
+  // (or the scalar tail) rewrites, so stop while 6 pixels remain.
+  uint32_t x = 0;
+  const __m128i m = load_mask(kBgrSwap);
+  for (; x + 6 <= width; x += 4) {
+    const __m128i v = loadu(src + (size_t)x * 3);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rgb + (size_t)x * 3), _mm_shuffle_epi8(v, m));
+  }
+  if (x < width) convert_kernels_scalar().bgr24_row(src + (size_t)x * 3, rgb + (size_t)x * 3, width - x);
+}
+
+template <int CS>
+TARGET_AVX2 void nv12_row_avx2(const uint8_t* y, const uint8_t* uv, uint8_t* rgb, uint32_t width, bool uv_swap) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const Yuv16 p = load_nv12(y + x, uv + x, uv_swap);
+    yuv16_to_rgb_avx2<CS>(p.y, p.u, p.v, rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).nv12_row(y + x, uv + x, rgb + (size_t)x * 3, width - x, uv_swap);
+}
+
+template <int CS>
+TARGET_AVX2 void nv24_row_avx2(const uint8_t* y, const uint8_t* uv, uint8_t* rgb, uint32_t width, bool uv_swap) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const Yuv16 p = load_nv24(y + x, uv + (size_t)x * 2, uv_swap);
+    yuv16_to_rgb_avx2<CS>(p.y, p.u, p.v, rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).nv24_row(y + x, uv + (size_t)x * 2, rgb + (size_t)x * 3, width - x, uv_swap);
+}
+
+template <int CS>
+TARGET_AVX2 void yuyv_row_avx2(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const Yuv16 p = load_yuyv(src + (size_t)x * 2);
+    yuv16_to_rgb_avx2<CS>(p.y, p.u, p.v, rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).yuyv_row(src + (size_t)x * 2, rgb + (size_t)x * 3, width - x);
+}
+
+template <int CS>
+TARGET_AVX2 void uyvy_row_avx2(const uint8_t* src, uint8_t* rgb, uint32_t width) {
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const Yuv16 p = load_uyvy(src + (size_t)x * 2);
+    yuv16_to_rgb_avx2<CS>(p.y, p.u, p.v, rgb + (size_t)x * 3);
+  }
+  if (x < width) convert_kernels_scalar(colorimetry_from_index(CS)).uyvy_row(src + (size_t)x * 2, rgb + (size_t)x * 3, width - x);
+}
+
+}  // namespace
+
+const ConvertKernels* convert_kernels_ssse3(Colorimetry cs) {
+  static constexpr auto k = make_kernel_table([](auto c) {
+    constexpr int CS = decltype(c)::value;
+    return ConvertKernels{
+        "ssse3",
+        nv12_row_ssse3<CS>,
+        nv24_row_ssse3<CS>,
+        yuyv_row_ssse3<CS>,
+        uyvy_row_ssse3<CS>,
+        bgr24_row_ssse3,
+    };
+  });
+  return __builtin_cpu_supports("ssse3") ? &k[colorimetry_index(cs)] : nullptr;
+}
+
+const ConvertKernels* convert_kernels_avx2(Colorimetry cs) {
+  // The BGR24 swap is a pure shuffle; 256-bit pshufb cannot cross lanes, so reuse SSSE3.
+  static constexpr auto k = make_kernel_table([](auto c) {
+    constexpr int CS = decltype(c)::value;
+    return ConvertKernels{
+        "avx2",
+        nv12_row_avx2<CS>,
+        nv24_row_avx2<CS>,
+        yuyv_row_avx2<CS>,
+        uyvy_row_avx2<CS>,
+        bgr24_row_ssse3,
+    };
+  });
+  return __builtin_cpu_supports("avx2") ? &k[colorimetry_index(cs)] : nullptr;
+}
+
+#else
+
+const ConvertKernels* convert_kernels_ssse3(Colorimetry) { return nullptr; }
+const ConvertKernels* convert_kernels_avx2(Colorimetry) { return nullptr; }
+
+#endif
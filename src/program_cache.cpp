@@ -0,0 +1,198 @@
+#include "program_cache.h"
+
+#include "shader_utils.h"
+
+#include <EGL/egl.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kMagic = 0x50354b52;  // "RK5P"
+constexpr uint32_t kVersion = 1;
+
+struct BlobHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format;  // binaryFormat from glGetProgramBinaryOES
+  uint32_t length;
+};
+
+uint64_t fnv1a(uint64_t h, const std::string& s) {
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 0x100000001b3ull;
+  }
+  // Separator, so ("ab", "c") and ("a", "bc") hash differently.
+  h ^= 0xff;
+  h *= 0x100000001b3ull;
+  return h;
+}
+
+std::string gl_string(GLenum name) {
+  const char* s = (const char*)glGetString(name);
+  return s ? std::string(s) : std::string();
+}
+
+bool make_dirs(const std::string& path) {
+  for (size_t pos = 1; pos <= path.size(); pos++) {
+    if (pos != path.size() && path[pos] != '/') continue;
+    const std::string sub = path.substr(0, pos);
+    if (::mkdir(sub.c_str(), 0755) != 0 && errno != EEXIST) return false;
+  }
+  return true;
+}
+
+bool read_file(const std::string& path, std::vector<char>& out) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st {};
+  bool ok = ::fstat(fd, &st) == 0 && st.st_size > (off_t)sizeof(BlobHeader);
+  if (ok) {
+    out.resize((size_t)st.st_size);
+    size_t off = 0;
+    while (off < out.size()) {
+      const ssize_t n = ::read(fd, out.data() + off, out.size() - off);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      off += (size_t)n;
+    }
+    ok = off == out.size();
+  }
+  ::close(fd);
+  return ok;
+}
+
+}  // namespace
+
+std::string ProgramCache::default_dir() {
+  const char* xdg = std::getenv("XDG_CACHE_HOME");
+  if (xdg && xdg[0] == '/') return std::string(xdg) + "/rock5b_hdmiin_gl";
+  const char* home = std::getenv("HOME");
+  if (home && home[0]) return std::string(home) + "/.cache/rock5b_hdmiin_gl";
+  return std::string();
+}
+
+bool ProgramCache::init(const std::string& dir, bool debug) {
+  ready_ = false;
+  debug_ = debug;
+  store_failed_ = false;
+  if (dir.empty()) return false;
+
+  const char* ext = (const char*)glGetString(GL_EXTENSIONS);
+  if (!ext || !std::strstr(ext, "GL_OES_get_program_binary")) {
+    if (debug_) std::fprintf(stderr, "[program_cache] GL_OES_get_program_binary missing; shaders are always compiled\n");
+    return false;
+  }
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+  if (formats <= 0) {
+    if (debug_) std::fprintf(stderr, "[program_cache] driver offers no program binary formats\n");
+    return false;
+  }
+  get_program_binary_ = (PFNGLGETPROGRAMBINARYOESPROC)eglGetProcAddress("glGetProgramBinaryOES");
+  program_binary_ = (PFNGLPROGRAMBINARYOESPROC)eglGetProcAddress("glProgramBinaryOES");
+  if (!get_program_binary_ || !program_binary_) return false;
+
+  if (!make_dirs(dir)) {
+    std::fprintf(stderr, "[program_cache] cannot create %s: %s\n", dir.c_str(), std::strerror(errno));
+    return false;
+  }
+  dir_ = dir;
+  driver_id_ = gl_string(GL_VENDOR) + '\n' + gl_string(GL_RENDERER) + '\n' + gl_string(GL_VERSION);
+  ready_ = true;
+  if (debug_) std::fprintf(stderr, "[program_cache] using %s\n", dir_.c_str());
+  return true;
+}
+
+GLuint ProgramCache::build(const std::string& vs_src, const std::string& fs_src) {
+  std::string path;
+  if (ready_) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = fnv1a(h, driver_id_);
+    h = fnv1a(h, vs_src);
+    h = fnv1a(h, fs_src);
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)h);
+    path = dir_ + name;
+    const GLuint prog = load(path);
+    if (prog) return prog;
+  }
+
+  GLuint vs = compile_shader(GL_VERTEX_SHADER, vs_src.c_str());
+  GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fs_src.c_str());
+  GLuint prog = (vs && fs) ? link_program(vs, fs) : 0;
+  // The program keeps what it needs.
+  if (vs) glDeleteShader(vs);
+  if (fs) glDeleteShader(fs);
+  if (prog && ready_) store(prog, path);
+  return prog;
+}
+
+GLuint ProgramCache::load(const std::string& path) {
+  std::vector<char> blob;
+  if (!read_file(path, blob)) return 0;
+
+  BlobHeader hdr{};
+  std::memcpy(&hdr, blob.data(), sizeof(hdr));
+  if (hdr.magic != kMagic || hdr.version != kVersion || hdr.length != blob.size() - sizeof(hdr)) {
+    ::unlink(path.c_str());
+    return 0;
+  }
+
+  GLuint prog = glCreateProgram();
+  program_binary_(prog, (GLenum)hdr.format, blob.data() + sizeof(hdr), (GLint)hdr.length);
+  GLint ok = 0;
+  glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+  if (!ok) {
+    // Typically a driver update the version string did not reveal; rebuild and replace it.
+    if (debug_) std::fprintf(stderr, "[program_cache] driver rejected %s, recompiling\n", path.c_str());
+    glDeleteProgram(prog);
+    ::unlink(path.c_str());
+    return 0;
+  }
+  if (debug_) std::fprintf(stderr, "[program_cache] hit %s\n", path.c_str());
+  return prog;
+}
+
+void ProgramCache::store(GLuint prog, const std::string& path) {
+  GLint len = 0;
+  glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH_OES, &len);
+  if (len <= 0) return;
+
+  std::vector<char> blob(sizeof(BlobHeader) + (size_t)len);
+  GLsizei written = 0;
+  GLenum format = 0;
+  get_program_binary_(prog, len, &written, &format, blob.data() + sizeof(BlobHeader));
+  if (written <= 0) return;
+  blob.resize(sizeof(BlobHeader) + (size_t)written);
+  const BlobHeader hdr{kMagic, kVersion, (uint32_t)format, (uint32_t)written};
+  std::memcpy(blob.data(), &hdr, sizeof(hdr));
+
+  // Temporary file + rename, so a concurrent or interrupted run never reads half a blob.
+  const std::string tmp = path + ".tmp";
+  const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  bool ok = fd >= 0;
+  size_t off = 0;
+  while (ok && off < blob.size()) {
+    const ssize_t n = ::write(fd, blob.data() + off, blob.size() - off);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) ok = false;
+    else off += (size_t)n;
+  }
+  if (fd >= 0) ::close(fd);
+  if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+    if (!store_failed_) std::fprintf(stderr, "[program_cache] writing %s failed: %s\n", path.c_str(), std::strerror(errno));
+    store_failed_ = true;
+    ::unlink(tmp.c_str());
+    return;
+  }
+  if (debug_) std::fprintf(stderr, "[program_cache] stored %s (%d bytes)\n", path.c_str(), (int)written);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#include <string>
+
+// Linked programs kept on disk via GL_OES_get_program_binary, so warm starts and profile
+// switches skip GLSL compilation. Entries are keyed by a hash of both shader sources and the
+// GL vendor, renderer and version strings, so a driver update or another GPU never loads a
+// stale blob. Without the extension, or if the driver rejects a blob, build() compiles.
+class ProgramCache {
+public:
+  // Needs a current context. `dir` is created if missing; an empty dir disables the cache.
+  // False (and build() always compiles) if the cache cannot be used.
+  bool init(const std::string& dir, bool debug);
+
+  // Same contract as compile_shader() + link_program(): a linked program or 0.
+  GLuint build(const std::string& vs_src, const std::string& fs_src);
+
+  // Default location: $XDG_CACHE_HOME/rock5b_hdmiin_gl, else ~/.cache/rock5b_hdmiin_gl.
+  static std::string default_dir();
+
+private:
+  GLuint load(const std::string& path);
+  void store(GLuint prog, const std::string& path);
+
+  PFNGLGETPROGRAMBINARYOESPROC get_program_binary_ = nullptr;
+  PFNGLPROGRAMBINARYOESPROC program_binary_ = nullptr;
+  std::string dir_;
+  std::string driver_id_;
+  bool ready_ = false;
+  bool debug_ = false;
+  bool store_failed_ = false;  // log an unwritable directory once, not per program
+};
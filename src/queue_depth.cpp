@@ -0,0 +1,79 @@
+#include "queue_depth.h"
+
+#include <cstdio>
+
+void QueueDepthController::reset(uint32_t min_depth, uint32_t max_depth) {
+  min_ = min_depth < 2 ? 2 : min_depth;
+  max_ = max_depth < min_ ? min_ : max_depth;
+  // Start generous and shrink; starting low would drop frames while it learns.
+  depth_ = max_;
+  window_start_ns_ = 0;
+  have_sequence_ = false;
+  last_sequence_ = 0;
+  dropped_ = 0;
+  starved_ = 0;
+  frames_ = 0;
+  held_max_ = 0;
+  clean_windows_ = 0;
+  bad_depth_ = 0;
+  bad_depth_hold_ = 0;
+  last_bad_depth_ = 0;
+  hold_windows_ = kBadDepthHoldWindows;
+  latency_sum_ns_.store(0, std::memory_order_relaxed);
+  latency_count_.store(0, std::memory_order_relaxed);
+}
+
+void QueueDepthController::on_frame(uint64_t now_ns, uint32_t sequence, uint32_t held) {
+  if (window_start_ns_ == 0) window_start_ns_ = now_ns;
+  if (have_sequence_ && sequence - last_sequence_ > 1 && sequence - last_sequence_ < 1000) {
+    dropped_ += sequence - last_sequence_ - 1;
+  }
+  have_sequence_ = true;
+  last_sequence_ = sequence;
+  frames_++;
+  if (held > held_max_) held_max_ = held;
+}
+
+void QueueDepthController::on_latency(uint64_t ns) {
+  latency_sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+  latency_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool QueueDepthController::update(uint64_t now_ns) {
+  if (window_start_ns_ == 0 || now_ns - window_start_ns_ < kWindowNs) return false;
+
+  const uint32_t lost = dropped_ + starved_;
+  const uint32_t old = depth_;
+  if (bad_depth_hold_ > 0 && --bad_depth_hold_ == 0) bad_depth_ = 0;
+
+  if (lost > 0) {
+    clean_windows_ = 0;
+    if (depth_ < max_) {
+      hold_windows_ = (depth_ == last_bad_depth_) ? hold_windows_ * 2 : kBadDepthHoldWindows;
+      if (hold_windows_ > kMaxBadDepthHoldWindows) hold_windows_ = kMaxBadDepthHoldWindows;
+      bad_depth_ = depth_;
+      last_bad_depth_ = depth_;
+      bad_depth_hold_ = hold_windows_;
+      depth_++;
+    }
+  } else if (frames_ > 0 && ++clean_windows_ >= kCleanWindowsToShrink) {
+    clean_windows_ = 0;
+    // One buffer being filled plus one queued behind it, on top of what the renderer holds.
+    const uint32_t floor = (held_max_ + 2 > min_) ? held_max_ + 2 : min_;
+    if (depth_ > floor && depth_ - 1 != bad_depth_) depth_--;
+  }
+
+  if (depth_ != old) {
+    const uint32_t n = latency_count_.exchange(0, std::memory_order_relaxed);
+    const uint64_t sum = latency_sum_ns_.exchange(0, std::memory_order_relaxed);
+    std::fprintf(stderr, "[queue_depth] depth %u -> %u (dropped=%u starved=%u held<=%u capture->flip avg %.1f ms)\n", old, depth_,
+                 dropped_, starved_, held_max_, n ? (double)sum / n / 1e6 : 0.0);
+  }
+
+  window_start_ns_ = now_ns;
+  dropped_ = 0;
+  starved_ = 0;
+  frames_ = 0;
+  held_max_ = 0;
+  return depth_ != old;
+}
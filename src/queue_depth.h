@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Picks how many capture buffers stay queued to the driver. Every window it looks at frames
+// the driver dropped (gaps in v4l2_buffer.sequence), queue-empty stalls and the most buffers
+// the renderer held at once: any drop grows the depth by one, and a run of clean windows
+// probes one lower. A depth that dropped frames is not probed again for a while, so the
+// controller settles on the smallest clean depth within a few seconds.
+//
+// on_frame()/on_starved()/update() run on the thread that does DQBUF/QBUF;
+// on_latency() may be called from the renderer.
+class QueueDepthController {
+public:
+  static constexpr uint64_t kWindowNs = 500000000ull;
+  static constexpr uint32_t kCleanWindowsToShrink = 2;
+  // How long a depth that dropped frames stays off limits (in windows); doubled each time the
+  // same depth fails again.
+  static constexpr uint32_t kBadDepthHoldWindows = 60;
+  static constexpr uint32_t kMaxBadDepthHoldWindows = 1920;
+
+  void reset(uint32_t min_depth, uint32_t max_depth);
+
+  // A buffer was dequeued; `held` is how many buffers the renderer has dequeued and not yet returned.
+  void on_frame(uint64_t now_ns, uint32_t sequence, uint32_t held);
+  // The driver was left with no buffer to fill (the last queued one was dequeued).
+  void on_starved() { starved_++; }
+  // Capture timestamp to page-flip completion, for the log only.
+  void on_latency(uint64_t ns);
+
+  // Closes the window if it has elapsed; returns true when depth() changed.
+  bool update(uint64_t now_ns);
+  uint32_t depth() const { return depth_; }
+
+private:
+  uint32_t min_ = 2;
+  uint32_t max_ = 2;
+  uint32_t depth_ = 2;
+
+  uint64_t window_start_ns_ = 0;
+  bool have_sequence_ = false;
+  uint32_t last_sequence_ = 0;
+  uint32_t dropped_ = 0;
+  uint32_t starved_ = 0;
+  uint32_t frames_ = 0;
+  uint32_t held_max_ = 0;
+  uint32_t clean_windows_ = 0;
+  uint32_t bad_depth_ = 0;  // 0 = none
+  uint32_t bad_depth_hold_ = 0;
+  uint32_t last_bad_depth_ = 0;
+  uint32_t hold_windows_ = kBadDepthHoldWindows;
+
+  std::atomic<uint64_t> latency_sum_ns_{0};
+  std::atomic<uint32_t> latency_count_{0};
+};
@@ -1,6 +1,8 @@
 #include "v4l2_capture.h"
+#include "pixel_convert.h"
 
 #include <linux/videodev2.h>
+#include <linux/dma-buf.h>
 #include <errno.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
@@ -8,7 +10,14 @@
 #include <unistd.h>
 #include <cstring>
 #include <cstdio>
+#include <cstdlib>
 #include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <algorithm>
+#include <time.h>
+
+static_assert(V4L2_MEMORY_MMAP == 1, "V4L2Capture::memory_ defaults to V4L2_MEMORY_MMAP");
 
 static int xioctl(int fd, unsigned long request, void* arg) {
   int r;
@@ -18,34 +27,38 @@ static int xioctl(int fd, unsigned long request, void* arg) {
   return r;
 }
 
-static void yuv_to_rgb(int Y, int U, int V, uint8_t& r, uint8_t& g, uint8_t& b);
+static uint64_t monotonic_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
 
-bool nv24_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height,
-                   uint32_t y_stride, uint32_t uv_stride, bool uv_swap, std::vector<uint8_t>& rgb_out) {
-  if (!y_plane || !uv_plane || width == 0 || height == 0) return false;
-  if (y_stride == 0) y_stride = width;
-  // NV24 is 4:4:4 with interleaved UV for every pixel: 2 bytes per pixel in UV plane.
-  if (uv_stride == 0) uv_stride = width * 2;
+const char* frame_policy_name(FramePolicy p) {
+  switch (p) {
+    case FramePolicy::Latest: return "latest";
+    case FramePolicy::Fifo: return "fifo";
+    case FramePolicy::Paced: return "paced";
+  }
+  return "?";
+}
 
-  rgb_out.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 3);
-  for (uint32_t y = 0; y < height; y++) {
-    const uint8_t* yrow = y_plane + static_cast<size_t>(y) * y_stride;
-    const uint8_t* uvrow = uv_plane + static_cast<size_t>(y) * uv_stride;
-    for (uint32_t x = 0; x < width; x++) {
-      const uint8_t Y0 = yrow[x];
-      const uint8_t U0 = uvrow[x * 2 + (uv_swap ? 1 : 0)];
-      const uint8_t V0 = uvrow[x * 2 + (uv_swap ? 0 : 1)];
-      uint8_t r, g, b;
-      yuv_to_rgb((int)Y0, (int)U0, (int)V0, r, g, b);
-      size_t oi = (static_cast<size_t>(y) * width + x) * 3;
-      rgb_out[oi + 0] = r;
-      rgb_out[oi + 1] = g;
-      rgb_out[oi + 2] = b;
-    }
+bool parse_frame_policy(const std::string& s, FramePolicy& out) {
+  if (s == "latest") {
+    out = FramePolicy::Latest;
+  } else if (s == "fifo") {
+    out = FramePolicy::Fifo;
+  } else if (s == "paced") {
+    out = FramePolicy::Paced;
+  } else {
+    return false;
   }
   return true;
 }
 
+static uint64_t frame_ts_ns(const V4L2Frame& f) {
+  return (uint64_t)f.ts_sec * 1000000000ull + (uint64_t)f.ts_usec * 1000ull;
+}
+
 static void fourcc_to_str(uint32_t f, char out[5]) {
   out[0] = (char)(f & 0xFF);
   out[1] = (char)((f >> 8) & 0xFF);
@@ -66,97 +79,236 @@ static void dump_supported_formats(int fd, uint32_t type) {
   }
 }
 
-static inline uint8_t clamp_u8_int(int v) {
-  if (v < 0) return 0;
-  if (v > 255) return 255;
-  return static_cast<uint8_t>(v);
-}
-
-static void yuv_to_rgb(int Y, int U, int V, uint8_t& r, uint8_t& g, uint8_t& b) {
-  // BT.601 limited range conversion (same constants as nv12_to_rgb24)
-  Y -= 16;
-  U -= 128;
-  V -= 128;
-  if (Y < 0) Y = 0;
-  int C = 298 * Y;
-  int rr = (C + 409 * V + 128) >> 8;
-  int gg = (C - 100 * U - 208 * V + 128) >> 8;
-  int bb = (C + 516 * U + 128) >> 8;
-  r = clamp_u8_int(rr);
-  g = clamp_u8_int(gg);
-  b = clamp_u8_int(bb);
-}
-
-static bool yuyv_to_rgb24(const uint8_t* src, uint32_t width, uint32_t height, uint32_t stride, std::vector<uint8_t>& rgb_out) {
-  if (!src || width == 0 || height == 0) return false;
-  if (stride == 0) stride = width * 2;
-  rgb_out.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 3);
-  for (uint32_t y = 0; y < height; y++) {
-    const uint8_t* row = src + static_cast<size_t>(y) * stride;
-    for (uint32_t x = 0; x < width; x += 2) {
-      const uint8_t Y0 = row[x * 2 + 0];
-      const uint8_t U0 = row[x * 2 + 1];
-      const uint8_t Y1 = row[x * 2 + 2];
-      const uint8_t V0 = row[x * 2 + 3];
-      uint8_t r, g, b;
-      size_t oi0 = (static_cast<size_t>(y) * width + x) * 3;
-      yuv_to_rgb((int)Y0, (int)U0, (int)V0, r, g, b);
-      rgb_out[oi0 + 0] = r;
-      rgb_out[oi0 + 1] = g;
-      rgb_out[oi0 + 2] = b;
-      if (x + 1 < width) {
-        size_t oi1 = (static_cast<size_t>(y) * width + (x + 1)) * 3;
-        yuv_to_rgb((int)Y1, (int)U0, (int)V0, r, g, b);
-        rgb_out[oi1 + 0] = r;
-        rgb_out[oi1 + 1] = g;
-        rgb_out[oi1 + 2] = b;
-      }
+bool V4L2Capture::open_device(const std::string& devnode) {
+  fd_ = ::open(devnode.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (fd_ < 0) return false;
+
+  v4l2_capability cap{};
+  if (xioctl(fd_, VIDIOC_QUERYCAP, &cap) == 0) {
+    if (debug_) {
+      std::fprintf(stderr, "[v4l2_capture] driver=%s card=%s bus=%s caps=0x%x device_caps=0x%x\n",
+                   cap.driver, cap.card, cap.bus_info, cap.capabilities, cap.device_caps);
     }
   }
+
+  // HDMI receivers report input resolution/format switches as a source-change event (POLLPRI).
+  v4l2_event_subscription sub{};
+  sub.type = V4L2_EVENT_SOURCE_CHANGE;
+  if (xioctl(fd_, VIDIOC_SUBSCRIBE_EVENT, &sub) == 0) {
+    source_change_events_ = true;
+  } else if (debug_) {
+    std::fprintf(stderr, "[v4l2_capture] V4L2_EVENT_SOURCE_CHANGE not supported: %s\n", std::strerror(errno));
+  }
+
   return true;
 }
 
-static bool uyvy_to_rgb24(const uint8_t* src, uint32_t width, uint32_t height, uint32_t stride, std::vector<uint8_t>& rgb_out) {
-  if (!src || width == 0 || height == 0) return false;
-  if (stride == 0) stride = width * 2;
-  rgb_out.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 3);
-  for (uint32_t y = 0; y < height; y++) {
-    const uint8_t* row = src + static_cast<size_t>(y) * stride;
-    for (uint32_t x = 0; x < width; x += 2) {
-      const uint8_t U0 = row[x * 2 + 0];
-      const uint8_t Y0 = row[x * 2 + 1];
-      const uint8_t V0 = row[x * 2 + 2];
-      const uint8_t Y1 = row[x * 2 + 3];
-      uint8_t r, g, b;
-      size_t oi0 = (static_cast<size_t>(y) * width + x) * 3;
-      yuv_to_rgb((int)Y0, (int)U0, (int)V0, r, g, b);
-      rgb_out[oi0 + 0] = r;
-      rgb_out[oi0 + 1] = g;
-      rgb_out[oi0 + 2] = b;
-      if (x + 1 < width) {
-        size_t oi1 = (static_cast<size_t>(y) * width + (x + 1)) * 3;
-        yuv_to_rgb((int)Y1, (int)U0, (int)V0, r, g, b);
-        rgb_out[oi1 + 0] = r;
-        rgb_out[oi1 + 1] = g;
-        rgb_out[oi1 + 2] = b;
-      }
+bool V4L2Capture::dequeue_events(bool& source_changed) {
+  source_changed = false;
+  if (fd_ < 0) return false;
+  while (true) {
+    v4l2_event ev{};
+    if (xioctl(fd_, VIDIOC_DQEVENT, &ev) < 0) {
+      // ENOENT: queue drained.
+      return errno == ENOENT;
+    }
+    if (ev.type == V4L2_EVENT_SOURCE_CHANGE && (ev.u.src_change.changes & V4L2_EVENT_SRC_CH_RESOLUTION)) {
+      source_changed = true;
     }
   }
+}
+
+bool V4L2Capture::apply_dv_timings() {
+  v4l2_dv_timings t{};
+  if (xioctl(fd_, VIDIOC_QUERY_DV_TIMINGS, &t) < 0) {
+    // ENOTTY/EINVAL: not a DV receiver, the format alone describes the source.
+    if (errno == ENOTTY || errno == EINVAL) return true;
+    std::fprintf(stderr, "[v4l2_capture] VIDIOC_QUERY_DV_TIMINGS failed (no stable signal?): %s\n", std::strerror(errno));
+    return false;
+  }
+  if (xioctl(fd_, VIDIOC_S_DV_TIMINGS, &t) < 0) {
+    // Some receivers follow the input on their own and reject S_DV_TIMINGS while idle.
+    if (debug_) std::fprintf(stderr, "[v4l2_capture] VIDIOC_S_DV_TIMINGS failed: %s\n", std::strerror(errno));
+  }
+  if (t.type == V4L2_DV_BT_656_1120) {
+    const v4l2_bt_timings& bt = t.bt;
+    const uint64_t htot = (uint64_t)bt.width + bt.hfrontporch + bt.hsync + bt.hbackporch;
+    const uint64_t vtot = (uint64_t)bt.height + bt.vfrontporch + bt.vsync + bt.vbackporch;
+    const double hz = (htot && vtot) ? (double)bt.pixelclock / (double)(htot * vtot) : 0.0;
+    std::fprintf(stderr, "[v4l2_capture] DV timings: %ux%u%s @ %.2f Hz\n", bt.width, bt.height, bt.interlaced ? "i" : "p", hz);
+  }
   return true;
 }
 
-bool V4L2Capture::open_device(const std::string& devnode) {
-  fd_ = ::open(devnode.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+bool V4L2Capture::reconfigure(uint32_t width, uint32_t height) {
   if (fd_ < 0) return false;
+  release_buffers();
+  if (!apply_dv_timings()) return false;
+  return configure(width, height);
+}
 
-  v4l2_capability cap{};
-  if (xioctl(fd_, VIDIOC_QUERYCAP, &cap) == 0) {
-    if (debug_) {
-      std::fprintf(stderr, "[v4l2_capture] driver=%s card=%s bus=%s caps=0x%x device_caps=0x%x\n",
-                   cap.driver, cap.card, cap.bus_info, cap.capabilities, cap.device_caps);
+void V4L2Capture::release_buffers() {
+  for (auto& b : buffers_) {
+    for (int p = 0; p < kMaxPlanes; p++) {
+      if (b.planes[p].start && b.planes[p].start != MAP_FAILED) munmap(b.planes[p].start, b.planes[p].length);
+      if (b.planes[p].fd >= 0) ::close(b.planes[p].fd);
+      b.planes[p].start = nullptr;
+      b.planes[p].length = 0;
+      b.planes[p].fd = -1;
+    }
+  }
+  const bool had_buffers = !buffers_.empty();
+  buffers_.clear();
+  parked_.clear();
+  warm_pending_ = false;
+  queued_ = 0;
+  frame_pool_.reset();
+
+  if (had_buffers && fd_ >= 0) {
+    v4l2_requestbuffers req{};
+    req.count = 0;
+    req.type = buf_type_;
+    req.memory = memory_;
+    if (xioctl(fd_, VIDIOC_REQBUFS, &req) < 0 && debug_) {
+      std::fprintf(stderr, "[v4l2_capture] VIDIOC_REQBUFS(0) failed: %s\n", std::strerror(errno));
+    }
+  }
+}
+
+// ENUM_FRAMESIZES is optional (HDMI receivers follow the input timings instead), so only a
+// size list that excludes the size rules a format out.
+static bool frame_size_supported(int fd, uint32_t fourcc, uint32_t w, uint32_t h) {
+  v4l2_frmsizeenum fs{};
+  fs.pixel_format = fourcc;
+  if (xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &fs) < 0) return true;
+  if (fs.type != V4L2_FRMSIZE_TYPE_DISCRETE) {
+    return w >= fs.stepwise.min_width && w <= fs.stepwise.max_width && h >= fs.stepwise.min_height && h <= fs.stepwise.max_height;
+  }
+  for (; xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &fs) == 0; fs.index++) {
+    if (fs.discrete.width == w && fs.discrete.height == h) return true;
+  }
+  return false;
+}
+
+// Candidates are what VIDIOC_TRY_FMT says the driver would deliver, so padding and plane
+// layout are known before anything is committed.
+std::vector<FormatPlan> V4L2Capture::plan_formats(uint32_t type, uint32_t width, uint32_t height) {
+  std::vector<uint32_t> offered;
+  v4l2_fmtdesc d{};
+  d.type = type;
+  for (d.index = 0; d.index < 64 && xioctl(fd_, VIDIOC_ENUM_FMT, &d) == 0; d.index++) offered.push_back(d.pixelformat);
+
+  std::vector<FormatCandidate> candidates;
+  for (const PlannableFormat& pf : plannable_formats()) {
+    if (std::find(offered.begin(), offered.end(), pf.fourcc) == offered.end()) continue;
+    if (type != V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE && pf.num_planes > 1) continue;
+
+    v4l2_format f{};
+    f.type = type;
+    FormatCandidate c;
+    if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+      f.fmt.pix_mp.pixelformat = pf.fourcc;
+      f.fmt.pix_mp.num_planes = pf.num_planes;
+      f.fmt.pix_mp.width = width;
+      f.fmt.pix_mp.height = height;
+      f.fmt.pix_mp.field = V4L2_FIELD_ANY;
+      if (xioctl(fd_, VIDIOC_TRY_FMT, &f) < 0) continue;
+      c.fourcc = f.fmt.pix_mp.pixelformat;
+      c.num_planes = f.fmt.pix_mp.num_planes;
+      c.width = f.fmt.pix_mp.width;
+      c.height = f.fmt.pix_mp.height;
+      c.bytesperline = f.fmt.pix_mp.plane_fmt[0].bytesperline;
+    } else {
+      f.fmt.pix.pixelformat = pf.fourcc;
+      f.fmt.pix.width = width;
+      f.fmt.pix.height = height;
+      f.fmt.pix.field = V4L2_FIELD_ANY;
+      if (xioctl(fd_, VIDIOC_TRY_FMT, &f) < 0) continue;
+      c.fourcc = f.fmt.pix.pixelformat;
+      c.num_planes = 1;
+      c.width = f.fmt.pix.width;
+      c.height = f.fmt.pix.height;
+      c.bytesperline = f.fmt.pix.bytesperline;
+    }
+    if (c.fourcc != pf.fourcc) continue;  // driver substituted another format
+    if (!frame_size_supported(fd_, c.fourcc, c.width, c.height)) continue;
+    candidates.push_back(c);
+  }
+
+  ImportCaps caps = import_caps_;
+  caps.gpu_yuv422 = gpu_yuv422_;
+  caps.gpu_bgr24 = gpu_bgr24_;
+  caps.pitch_realigned = dmabuf_alloc_.alloc && dmabuf_alloc_.pitch_align > 1;
+  return rank_formats(candidates, caps);
+}
+
+// Asks the driver for a row pitch the importers accept. Drivers that cannot honour it keep
+// their own; the G_FMT that follows picks up whatever was applied.
+void V4L2Capture::align_bytesperline(uint32_t type) {
+  v4l2_format f{};
+  f.type = type;
+  if (xioctl(fd_, VIDIOC_G_FMT, &f) < 0) return;
+
+  const uint32_t a = dmabuf_alloc_.pitch_align;
+  auto aligned = [a](uint32_t bpl) { return (bpl + a - 1) / a * a; };
+  // sizeimage=0 lets the driver recompute it for the new pitch.
+  bool changed = false;
+  if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+    for (uint32_t p = 0; p < f.fmt.pix_mp.num_planes && p < VIDEO_MAX_PLANES; p++) {
+      v4l2_plane_pix_format& pf = f.fmt.pix_mp.plane_fmt[p];
+      if (pf.bytesperline == 0 || pf.bytesperline % a == 0) continue;
+      pf.bytesperline = aligned(pf.bytesperline);
+      pf.sizeimage = 0;
+      changed = true;
+    }
+  } else if (f.fmt.pix.bytesperline != 0 && f.fmt.pix.bytesperline % a != 0) {
+    f.fmt.pix.bytesperline = aligned(f.fmt.pix.bytesperline);
+    f.fmt.pix.sizeimage = 0;
+    changed = true;
+  }
+  if (!changed) return;
+  if (xioctl(fd_, VIDIOC_S_FMT, &f) < 0 && debug_) {
+    std::fprintf(stderr, "[v4l2_capture] S_FMT with %u-byte pitch alignment failed: %s\n", a, std::strerror(errno));
+  }
+}
+
+// V4L2_MEMORY_DMABUF: the driver writes into buffers from dmabuf_alloc_, one fd per plane.
+// They are mapped read-only for the CPU conversion and upload paths.
+bool V4L2Capture::allocate_dmabuf_buffers(uint32_t count, const size_t* sizes) {
+  memory_ = V4L2_MEMORY_DMABUF;
+
+  v4l2_requestbuffers req{};
+  req.count = count;
+  req.type = buf_type_;
+  req.memory = V4L2_MEMORY_DMABUF;
+  if (xioctl(fd_, VIDIOC_REQBUFS, &req) < 0) {
+    std::fprintf(stderr, "[v4l2_capture] VIDIOC_REQBUFS(DMABUF) failed: %s\n", std::strerror(errno));
+    return false;
+  }
+  if (req.count < 2) return false;
+
+  const uint32_t nplanes = (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) ? num_planes_ : 1;
+  if (nplanes > (uint32_t)kMaxPlanes) return false;
+
+  buffers_.resize(req.count);
+  for (uint32_t i = 0; i < req.count; i++) {
+    for (uint32_t p = 0; p < nplanes; p++) {
+      Plane& pl = buffers_[i].planes[p];
+      pl.fd = dmabuf_alloc_.alloc(dmabuf_alloc_.ctx, sizes[p]);
+      if (pl.fd < 0) return false;
+      pl.length = sizes[p];
+      pl.start = mmap(nullptr, pl.length, PROT_READ, MAP_SHARED, pl.fd, 0);
+      if (pl.start == MAP_FAILED) {
+        pl.start = nullptr;
+        std::fprintf(stderr, "[v4l2_capture] mmap of %s buffer failed: %s\n", dmabuf_alloc_.name, std::strerror(errno));
+        return false;
+      }
     }
   }
 
+  dmabuf_export_supported_ = true;
+  std::fprintf(stderr, "[v4l2_capture] capture memory: %u %s buffers (V4L2_MEMORY_DMABUF, %u plane%s)\n", req.count,
+               dmabuf_alloc_.name, nplanes, nplanes == 1 ? "" : "s");
   return true;
 }
 
@@ -266,7 +418,42 @@ bool V4L2Capture::configure(uint32_t width, uint32_t height) {
       return false;
     };
 
-    if (!try_formats()) {
+    auto try_planned = [&]() -> bool {
+      if (!plan_formats_) return false;
+      const bool mp = (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
+      const uint32_t w = width ? width : (mp ? fmt.fmt.pix_mp.width : fmt.fmt.pix.width);
+      const uint32_t h = height ? height : (mp ? fmt.fmt.pix_mp.height : fmt.fmt.pix.height);
+      const std::vector<FormatPlan> plans = plan_formats(type, w, h);
+      if (plans.empty()) {
+        if (debug_) std::fprintf(stderr, "[v4l2_capture] format plan: no ranked candidates, using fixed order\n");
+        return false;
+      }
+      for (const FormatPlan& p : plans) {
+        char s[5];
+        fourcc_to_str(p.format.fourcc, s);
+        if (debug_) {
+          std::fprintf(stderr, "[v4l2_capture] format plan candidate: %s %ux%u stride=%u %s est %.0f us/frame\n", s, p.format.width,
+                       p.format.height, p.format.bytesperline, capture_path_name(p.path), p.cost_us);
+        }
+      }
+      for (const FormatPlan& p : plans) {
+        errno = 0;
+        const bool ok = mp ? try_set_mplane(p.format.fourcc, p.format.num_planes) : try_set_single(p.format.fourcc);
+        const uint32_t got = mp ? fmt.fmt.pix_mp.pixelformat : fmt.fmt.pix.pixelformat;
+        char s[5];
+        fourcc_to_str(p.format.fourcc, s);
+        if (ok && got == p.format.fourcc) {
+          std::fprintf(stderr, "[v4l2_capture] format plan: %s %ux%u via %s, est %.0f us/frame (%zu candidate%s)\n", s,
+                       p.format.width, p.format.height, capture_path_name(p.path), p.cost_us, plans.size(),
+                       plans.size() == 1 ? "" : "s");
+          return true;
+        }
+        std::fprintf(stderr, "[v4l2_capture] format plan: VIDIOC_S_FMT %s failed: %s\n", s, ok ? "driver picked another format" : std::strerror(errno));
+      }
+      return false;
+    };
+
+    if (!try_planned() && !try_formats()) {
       // Some HDMI-RX drivers do not allow changing pixel format depending on input mode.
       // If everything fails, keep the original driver-selected format instead of failing.
       fmt = fmt_orig;
@@ -275,6 +462,8 @@ bool V4L2Capture::configure(uint32_t width, uint32_t height) {
       }
     }
 
+    if (dmabuf_alloc_.alloc && dmabuf_alloc_.pitch_align > 1) align_bytesperline(type);
+
     v4l2_format got{};
     got.type = type;
     if (xioctl(fd_, VIDIOC_G_FMT, &got) == 0) fmt = got;
@@ -286,6 +475,7 @@ bool V4L2Capture::configure(uint32_t width, uint32_t height) {
       fourcc_ = fmt.fmt.pix_mp.pixelformat;
       num_planes_ = fmt.fmt.pix_mp.num_planes;
       if (num_planes_ < 1) return false;
+      colorimetry_ = colorimetry_from_v4l2(fmt.fmt.pix_mp.colorspace, fmt.fmt.pix_mp.ycbcr_enc, fmt.fmt.pix_mp.quantization);
 
       y_stride_ = fmt.fmt.pix_mp.plane_fmt[0].bytesperline;
       uv_stride_ = (num_planes_ >= 2) ? fmt.fmt.pix_mp.plane_fmt[1].bytesperline : 0;
@@ -300,6 +490,8 @@ bool V4L2Capture::configure(uint32_t width, uint32_t height) {
       } else if (is_nv24 && num_planes_ == 1) {
         if (y_stride_ == 0) y_stride_ = width_;
         uv_stride_ = width_ * 2;
+      } else if (fourcc_ == V4L2_PIX_FMT_BGR24) {
+        if (y_stride_ == 0) y_stride_ = width_ * 3;
       } else {
         if (y_stride_ == 0) y_stride_ = width_;
         if (uv_stride_ == 0) uv_stride_ = y_stride_;
@@ -312,39 +504,59 @@ bool V4L2Capture::configure(uint32_t width, uint32_t height) {
       height_ = fmt.fmt.pix.height;
       fourcc_ = fmt.fmt.pix.pixelformat;
       num_planes_ = 1;
+      colorimetry_ = colorimetry_from_v4l2(fmt.fmt.pix.colorspace, fmt.fmt.pix.ycbcr_enc, fmt.fmt.pix.quantization);
       y_stride_ = fmt.fmt.pix.bytesperline;
       uv_stride_ = 0;
       const uint32_t size0 = fmt.fmt.pix.sizeimage;
       if (y_stride_ == 0) {
-        // For packed 4:2:2 formats, default stride is width*2.
-        y_stride_ = (fourcc_ == V4L2_PIX_FMT_YUYV || fourcc_ == V4L2_PIX_FMT_UYVY) ? (width_ * 2) : width_;
+        // For packed 4:2:2 formats, default stride is width*2; BGR24 is width*3.
+        if (fourcc_ == V4L2_PIX_FMT_YUYV || fourcc_ == V4L2_PIX_FMT_UYVY) {
+          y_stride_ = width_ * 2;
+        } else if (fourcc_ == V4L2_PIX_FMT_BGR24) {
+          y_stride_ = width_ * 3;
+        } else {
+          y_stride_ = width_;
+        }
       }
       std::fprintf(stderr,
                    "[v4l2_capture] negotiated: %ux%u fourcc=0x%08x type=CAPTURE stride=%u size=%u\n",
                    width_, height_, fourcc_, y_stride_, size0);
     }
 
+    std::fprintf(stderr, "[v4l2_capture] colorimetry: %s\n", colorimetry_name(colorimetry_));
+
     if ((width != 0 && width_ != width) || (height != 0 && height_ != height)) {
       std::fprintf(stderr,
                    "[v4l2_capture] WARNING: requested %ux%u but driver negotiated %ux%u\n",
                    width, height, width_, height_);
     }
 
+    uint32_t want = reqbuf_count_ < 2 ? 2 : reqbuf_count_;
+    // FIFO/paced hold a backlog of capture buffers on the zero-copy path; see backlog_limit().
+    if (frame_policy_ != FramePolicy::Latest && want < kMaxBacklog + 3) want = kMaxBacklog + 3;
+    if (dmabuf_alloc_.alloc) {
+      size_t sizes[kMaxPlanes] = {};
+      if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        for (uint32_t p = 0; p < num_planes_ && p < (uint32_t)kMaxPlanes; p++) sizes[p] = fmt.fmt.pix_mp.plane_fmt[p].sizeimage;
+      } else {
+        sizes[0] = fmt.fmt.pix.sizeimage;
+      }
+      if (allocate_dmabuf_buffers(want, sizes)) return true;
+      std::fprintf(stderr, "[v4l2_capture] %s buffers unavailable, falling back to driver (MMAP) buffers\n", dmabuf_alloc_.name);
+      release_buffers();
+    }
+    memory_ = V4L2_MEMORY_MMAP;
+
     v4l2_requestbuffers req{};
-    req.count = reqbuf_count_ < 2 ? 2 : reqbuf_count_;
+    req.count = want;
     req.type = buf_type_;
     req.memory = V4L2_MEMORY_MMAP;
     if (xioctl(fd_, VIDIOC_REQBUFS, &req) < 0) return false;
     if (req.count < 2) return false;
 
     buffers_.resize(req.count);
+    bool all_exported = true;
     for (uint32_t i = 0; i < req.count; i++) {
-      buffers_[i].dmabuf_fd = -1;
-      for (int p = 0; p < 2; p++) {
-        buffers_[i].planes[p].start = nullptr;
-        buffers_[i].planes[p].length = 0;
-      }
-
       v4l2_buffer buf{};
       v4l2_plane planes[VIDEO_MAX_PLANES]{};
       buf.type = buf_type_;
@@ -357,7 +569,7 @@ bool V4L2Capture::configure(uint32_t width, uint32_t height) {
       if (xioctl(fd_, VIDIOC_QUERYBUF, &buf) < 0) return false;
 
       if (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
-        for (uint32_t p = 0; p < buf.length && p < 2; p++) {
+        for (uint32_t p = 0; p < buf.length && p < (uint32_t)kMaxPlanes; p++) {
           buffers_[i].planes[p].length = buf.m.planes[p].length;
           buffers_[i].planes[p].start = mmap(nullptr,
                                              buf.m.planes[p].length,
@@ -378,17 +590,23 @@ bool V4L2Capture::configure(uint32_t width, uint32_t height) {
         if (buffers_[i].planes[0].start == MAP_FAILED) return false;
       }
 
-      v4l2_exportbuffer exp{};
-      std::memset(&exp, 0, sizeof(exp));
-      exp.type = buf_type_;
-      exp.index = i;
-      exp.plane = 0;
-      exp.flags = O_CLOEXEC;
-      if (xioctl(fd_, VIDIOC_EXPBUF, &exp) == 0) {
-        buffers_[i].dmabuf_fd = exp.fd;
-        dmabuf_export_supported_ = true;
+      // One fd per plane: NV12M and friends keep chroma in a separate allocation.
+      const uint32_t nplanes = (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) ? num_planes_ : 1;
+      for (uint32_t p = 0; p < nplanes && p < (uint32_t)kMaxPlanes; p++) {
+        v4l2_exportbuffer exp{};
+        std::memset(&exp, 0, sizeof(exp));
+        exp.type = buf_type_;
+        exp.index = i;
+        exp.plane = p;
+        exp.flags = O_CLOEXEC;
+        if (xioctl(fd_, VIDIOC_EXPBUF, &exp) == 0) {
+          buffers_[i].planes[p].fd = exp.fd;
+        } else {
+          all_exported = false;
+        }
       }
     }
+    dmabuf_export_supported_ = all_exported && num_planes_ <= (uint32_t)kMaxPlanes;
 
     return true;
   };
@@ -401,7 +619,7 @@ bool V4L2Capture::configure(uint32_t width, uint32_t height) {
   }
 
   if (dmabuf_export_supported_) {
-    if (debug_) std::fprintf(stderr, "[v4l2_capture] DMABUF export supported (VIDIOC_EXPBUF ok)\n");
+    if (debug_) std::fprintf(stderr, "[v4l2_capture] DMABUF export supported (%u plane fd%s per buffer)\n", num_planes_, num_planes_ == 1 ? "" : "s");
   } else {
     if (debug_) std::fprintf(stderr, "[v4l2_capture] DMABUF export not supported (VIDIOC_EXPBUF failed)\n");
   }
@@ -411,28 +629,66 @@ bool V4L2Capture::configure(uint32_t width, uint32_t height) {
 
 int V4L2Capture::dmabuf_fd(uint32_t index) const {
   if (index >= buffers_.size()) return -1;
-  return buffers_[index].dmabuf_fd;
+  return buffers_[index].planes[0].fd;
+}
+
+bool V4L2Capture::dmabuf_plane(uint32_t index, uint32_t plane, DmabufPlane& out) const {
+  if (index >= buffers_.size() || plane >= (uint32_t)kMaxPlanes) return false;
+  const Buffer& b = buffers_[index];
+  if (plane == 0) {
+    out.fd = b.planes[0].fd;
+    out.offset = 0;
+    out.pitch = y_stride_;
+  } else if (num_planes_ > plane) {
+    out.fd = b.planes[plane].fd;
+    out.offset = 0;
+    out.pitch = uv_stride_;
+  } else if (plane == 2) {
+    return false;
+  } else {
+    // Contiguous NV12/NV16/NV24: chroma follows the luma rows in the same buffer.
+    out.fd = b.planes[0].fd;
+    out.offset = y_stride_ * height_;
+    out.pitch = uv_stride_;
+  }
+  return out.fd >= 0;
 }
 
 bool V4L2Capture::start() {
   if (fd_ < 0) return false;
 
+  queued_ = 0;
+  parked_.clear();
+  backlog_count_ = 0;
+  pace_delay_ns_ = 0;
+  // STREAMON restarts the driver's sequence count.
+  have_sequence_ = false;
+  // Start with every buffer in flight; the controller then probes downwards.
+  if (adaptive_depth_) depth_ctl_.reset(2, (uint32_t)buffers_.size());
   for (uint32_t i = 0; i < buffers_.size(); i++) {
-    v4l2_buffer buf{};
-    v4l2_plane planes[VIDEO_MAX_PLANES]{};
-    buf.type = buf_type_;
-    buf.memory = V4L2_MEMORY_MMAP;
-    buf.index = i;
-    if (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
-      buf.m.planes = planes;
-      buf.length = num_planes_;
-    }
-    if (xioctl(fd_, VIDIOC_QBUF, &buf) < 0) return false;
+    if (!queue_buffer(i)) return false;
   }
 
   v4l2_buf_type type = (v4l2_buf_type)buf_type_;
   if (xioctl(fd_, VIDIOC_STREAMON, &type) < 0) return false;
 
+  const bool packed422 = (fourcc_ == V4L2_PIX_FMT_YUYV) || (fourcc_ == V4L2_PIX_FMT_UYVY);
+  const bool cpu_convert = (packed422 && !gpu_yuv422_) || (fourcc_ == V4L2_PIX_FMT_BGR24 && !gpu_bgr24_);
+  if (cpu_convert && !convert_pool_.running()) convert_pool_.start(convert_threads_, debug_);
+  if (cpu_convert) {
+    // One slot being filled, one held by the renderer, one spare; the capture thread may
+    // additionally have one sitting in the ready queue, and FIFO/paced keep a backlog (with
+    // the capture thread, up to another backlog's worth can wait in the ready queue).
+    uint32_t slots = use_capture_thread_ ? 4 : 3;
+    if (frame_policy_ != FramePolicy::Latest) slots += use_capture_thread_ ? 2 * kMaxBacklog : kMaxBacklog;
+    const size_t rgb_bytes = static_cast<size_t>(width_) * static_cast<size_t>(height_) * 3;
+    if (!frame_pool_.init(slots, rgb_bytes)) return false;
+  }
+
+  // Drain the garbage some receivers deliver right after STREAMON, but only until the first
+  // good frame, instead of a fixed dozen being thrown away. That frame stays dequeued and is
+  // what the first acquire_frame() returns unless a newer one has arrived by then.
+  warm_pending_ = false;
   for (int i = 0; i < 12; i++) {
     pollfd pfd{};
     pfd.fd = fd_;
@@ -442,46 +698,115 @@ bool V4L2Capture::start() {
 
     v4l2_buffer b{};
     v4l2_plane planes[VIDEO_MAX_PLANES]{};
-    b.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-    b.memory = V4L2_MEMORY_MMAP;
-    b.m.planes = planes;
-    b.length = num_planes_;
+    b.type = buf_type_;
+    b.memory = memory_;
+    if (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+      b.m.planes = planes;
+      b.length = num_planes_;
+    }
     if (xioctl(fd_, VIDIOC_DQBUF, &b) < 0) {
       if (errno == EAGAIN) break;
       break;
     }
-    xioctl(fd_, VIDIOC_QBUF, &b);
+    note_dequeued(b);
+    const uint32_t used = (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) ? planes[0].bytesused : b.bytesused;
+    const bool valid = !(b.flags & V4L2_BUF_FLAG_ERROR) && used > 0;
+    if (valid) {
+      warm_index_ = b.index;
+      warm_sequence_ = b.sequence;
+      warm_ts_sec_ = (int64_t)b.timestamp.tv_sec;
+      warm_ts_usec_ = (int64_t)b.timestamp.tv_usec;
+      warm_pending_ = true;
+      break;
+    }
+    queue_buffer(b.index);
   }
 
+  if (use_capture_thread_ && !start_capture_thread()) return false;
   return true;
 }
 
-bool V4L2Capture::acquire_frame(V4L2Frame& out) {
+bool V4L2Capture::acquire_frame(V4L2Frame& out, uint64_t present_ns) {
   if (fd_ < 0) return false;
 
   out.needs_release = false;
   out.plane0 = nullptr;
   out.plane1 = nullptr;
-  out.data.clear();
+  out.plane2 = nullptr;
+  out.data = nullptr;
+  out.pool_slot = -1;
+  out.sequence = 0;
   out.ts_sec = 0;
   out.ts_usec = 0;
 
-  pollfd pfd{};
-  pfd.fd = fd_;
-  pfd.events = POLLIN;
-  int pr = poll(&pfd, 1, 16);
-  if (pr == 0) return true;
-  if (pr < 0) return false;
+  if (capture_thread_.joinable()) {
+    if (frame_policy_ == FramePolicy::Latest) return acquire_from_thread(out);
+    uint64_t n = 0;
+    if (::read(ready_fd_, &n, sizeof(n)) < 0) {
+      // EAGAIN: nothing new since the last acquire.
+    }
+    V4L2Frame f;
+    while (ready_.pop(f)) push_backlog(f);
+    return pick_from_backlog(out, present_ns);
+  }
+
+  if (frame_policy_ != FramePolicy::Latest) {
+    // Dequeue everything first and fill only the newest frames the backlog can hold, so frames
+    // it would drop again are never converted.
+    const uint32_t limit = backlog_limit();
+    v4l2_buffer kept[kMaxBacklog]{};
+    v4l2_plane kept_planes[kMaxBacklog][VIDEO_MAX_PLANES]{};
+    uint32_t kept_count = take_warm_frame(kept[0], kept_planes[0]) ? 1 : 0;
+    bool failed = false;
+    while (true) {
+      v4l2_buffer buf{};
+      v4l2_plane planes[VIDEO_MAX_PLANES]{};
+      buf.type = buf_type_;
+      buf.memory = memory_;
+      if (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        buf.m.planes = planes;
+        buf.length = num_planes_;
+      }
+      if (xioctl(fd_, VIDIOC_DQBUF, &buf) < 0) {
+        if (errno == EAGAIN) break;
+        if (errno == EPIPE && source_change_events_) break;
+        failed = true;
+        break;
+      }
+      note_dequeued(buf);
+      if (kept_count == limit) {
+        if (!queue_buffer(kept[0].index)) failed = true;
+        frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+        for (uint32_t i = 1; i < kept_count; i++) {
+          kept[i - 1] = kept[i];
+          std::memcpy(kept_planes[i - 1], kept_planes[i], sizeof(kept_planes[i]));
+          kept[i - 1].m.planes = kept_planes[i - 1];
+        }
+        kept_count--;
+      }
+      kept[kept_count] = buf;
+      std::memcpy(kept_planes[kept_count], planes, sizeof(planes));
+      kept[kept_count].m.planes = kept_planes[kept_count];
+      kept_count++;
+    }
+    adapt_depth();
+    for (uint32_t i = 0; i < kept_count; i++) {
+      V4L2Frame f;
+      if (fill_frame(kept[i], f)) push_backlog(f);
+    }
+    if (failed) return false;
+    return pick_from_backlog(out, present_ns);
+  }
 
-  bool have = false;
   v4l2_buffer last{};
   v4l2_plane last_planes[VIDEO_MAX_PLANES]{};
+  bool have = take_warm_frame(last, last_planes);
 
   while (true) {
     v4l2_buffer buf{};
     v4l2_plane planes[VIDEO_MAX_PLANES]{};
     buf.type = buf_type_;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf.memory = memory_;
     if (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
       buf.m.planes = planes;
       buf.length = num_planes_;
@@ -489,11 +814,16 @@ bool V4L2Capture::acquire_frame(V4L2Frame& out) {
 
     if (xioctl(fd_, VIDIOC_DQBUF, &buf) < 0) {
       if (errno == EAGAIN) break;
+      // EPIPE: the driver stopped the queue on an input change; the source-change event
+      // that follows restarts capture.
+      if (errno == EPIPE && source_change_events_) break;
       return false;
     }
+    note_dequeued(buf);
 
     if (have) {
-      if (xioctl(fd_, VIDIOC_QBUF, &last) < 0) return false;
+      if (!queue_buffer(last.index)) return false;
+      frames_dropped_.fetch_add(1, std::memory_order_relaxed);
     }
 
     last = buf;
@@ -501,9 +831,15 @@ bool V4L2Capture::acquire_frame(V4L2Frame& out) {
     last.m.planes = last_planes;
     have = true;
   }
+  adapt_depth();
 
   if (!have) return true;
+  return fill_frame(last, out);
+}
 
+// Fills `out` from a dequeued buffer. The CPU conversion paths convert into a frame-pool lease
+// and requeue `buf` right away; everything else keeps it dequeued until release_frame().
+bool V4L2Capture::fill_frame(v4l2_buffer& last, V4L2Frame& out) {
   out.width = width_;
   out.height = height_;
   out.fourcc = fourcc_;
@@ -512,18 +848,29 @@ bool V4L2Capture::acquire_frame(V4L2Frame& out) {
   out.uv_stride = uv_stride_;
   out.index = last.index;
   out.needs_release = true;
+  out.sequence = last.sequence;
   out.ts_sec = last.timestamp.tv_sec;
   out.ts_usec = last.timestamp.tv_usec;
   out.plane0 = nullptr;
   out.plane1 = nullptr;
-  out.data.clear();
+  out.plane2 = nullptr;
 
   const bool is_nv12 = (fourcc_ == V4L2_PIX_FMT_NV12) || (fourcc_ == V4L2_PIX_FMT_NV12M);
+  const bool is_nv16 = (fourcc_ == V4L2_PIX_FMT_NV16) || (fourcc_ == V4L2_PIX_FMT_NV16M);
+  const bool is_yuv420m = (fourcc_ == V4L2_PIX_FMT_YUV420M);
   const bool is_nv24 = (fourcc_ == V4L2_PIX_FMT_NV24);
-
-  if (is_nv12) {
+  const bool passthrough = (gpu_yuv422_ && (fourcc_ == V4L2_PIX_FMT_YUYV || fourcc_ == V4L2_PIX_FMT_UYVY)) ||
+                           (gpu_bgr24_ && fourcc_ == V4L2_PIX_FMT_BGR24);
+  // Imported buffers get no cache maintenance from the driver; bracket CPU reads ourselves.
+  // The GPU import path needs none, so zero-copy frames skip the sync.
+  const bool cpu_reads = !(is_nv12 || is_nv16 || is_yuv420m || is_nv24 || passthrough) || cpu_plane_access_.load(std::memory_order_relaxed);
+  if (memory_ == V4L2_MEMORY_DMABUF && cpu_reads) begin_cpu_access(last.index);
+
+  if (is_nv12 || is_nv16) {
+    // NV16 is NV12 with full-height chroma.
+    const uint32_t uv_rows = is_nv16 ? height_ : height_ / 2;
     const size_t y_size = static_cast<size_t>(y_stride_) * static_cast<size_t>(height_);
-    const size_t uv_size = static_cast<size_t>(uv_stride_) * static_cast<size_t>(height_ / 2);
+    const size_t uv_size = static_cast<size_t>(uv_stride_) * static_cast<size_t>(uv_rows);
 
     if (num_planes_ >= 2) {
       out.plane0 = static_cast<const uint8_t*>(buffers_[last.index].planes[0].start);
@@ -532,17 +879,27 @@ bool V4L2Capture::acquire_frame(V4L2Frame& out) {
       const uint8_t* base = static_cast<const uint8_t*>(buffers_[last.index].planes[0].start);
       const size_t avail = buffers_[last.index].planes[0].length;
       if (avail < (y_size + uv_size)) {
-        std::fprintf(stderr, "[v4l2_capture] NV12 single-plane buffer too small: have=%zu need=%zu\n", avail, (y_size + uv_size));
-        xioctl(fd_, VIDIOC_QBUF, &last);
+        std::fprintf(stderr, "[v4l2_capture] %s single-plane buffer too small: have=%zu need=%zu\n", is_nv16 ? "NV16" : "NV12", avail,
+                     (y_size + uv_size));
+        queue_buffer(last.index);
         return false;
       }
       out.plane0 = base;
       out.plane1 = base + y_size;
     } else {
       std::fprintf(stderr, "[v4l2_capture] NV12 but num_planes_=0\n");
-      xioctl(fd_, VIDIOC_QBUF, &last);
+      queue_buffer(last.index);
       return false;
     }
+  } else if (is_yuv420m) {
+    if (num_planes_ < 3) {
+      std::fprintf(stderr, "[v4l2_capture] YUV420M with %u planes\n", num_planes_);
+      queue_buffer(last.index);
+      return false;
+    }
+    out.plane0 = static_cast<const uint8_t*>(buffers_[last.index].planes[0].start);
+    out.plane1 = static_cast<const uint8_t*>(buffers_[last.index].planes[1].start);
+    out.plane2 = static_cast<const uint8_t*>(buffers_[last.index].planes[2].start);
   } else if (is_nv24) {
     // NV24 (YUV444): rk_hdmirx provides a single-plane buffer with Y plane followed by full-res interleaved UV.
     const uint8_t* base = static_cast<const uint8_t*>(buffers_[last.index].planes[0].start);
@@ -553,148 +910,448 @@ bool V4L2Capture::acquire_frame(V4L2Frame& out) {
     const size_t uv_size = static_cast<size_t>(uv_stride_) * static_cast<size_t>(height_);
     if (avail < (y_size + uv_size)) {
       std::fprintf(stderr, "[v4l2_capture] NV24 buffer too small: have=%zu need=%zu\n", avail, (y_size + uv_size));
-      xioctl(fd_, VIDIOC_QBUF, &last);
+      queue_buffer(last.index);
       return false;
     }
     out.plane0 = base;
     out.plane1 = base + y_size;
+  } else if (passthrough && num_planes_ >= 1) {
+    // Handed to the renderer as-is; the shader does the 4:2:2 decode or R/B swap.
+    const size_t need = static_cast<size_t>(y_stride_) * static_cast<size_t>(height_);
+    if (buffers_[last.index].planes[0].length < need) {
+      std::fprintf(stderr, "[v4l2_capture] packed buffer too small: have=%zu need=%zu\n", buffers_[last.index].planes[0].length, need);
+      queue_buffer(last.index);
+      return false;
+    }
+    out.plane0 = static_cast<const uint8_t*>(buffers_[last.index].planes[0].start);
   } else if (fourcc_ == V4L2_PIX_FMT_YUYV && num_planes_ >= 1) {
     const uint8_t* src = static_cast<const uint8_t*>(buffers_[last.index].planes[0].start);
-    if (!yuyv_to_rgb24(src, width_, height_, y_stride_, out.data)) {
-      xioctl(fd_, VIDIOC_QBUF, &last);
+    uint8_t* dst = lease_rgb(out);
+    if (!dst || !yuyv_to_rgb24(src, width_, height_, y_stride_, colorimetry_, dst, &convert_pool_)) {
+      release_rgb(out);
+      queue_buffer(last.index);
       return false;
     }
     out.needs_release = false;
     out.plane0 = nullptr;
     out.plane1 = nullptr;
-    if (xioctl(fd_, VIDIOC_QBUF, &last) < 0) return false;
+    if (!queue_buffer(last.index)) return false;
   } else if (fourcc_ == V4L2_PIX_FMT_UYVY && num_planes_ >= 1) {
     const uint8_t* src = static_cast<const uint8_t*>(buffers_[last.index].planes[0].start);
-    if (!uyvy_to_rgb24(src, width_, height_, y_stride_, out.data)) {
-      xioctl(fd_, VIDIOC_QBUF, &last);
+    uint8_t* dst = lease_rgb(out);
+    if (!dst || !uyvy_to_rgb24(src, width_, height_, y_stride_, colorimetry_, dst, &convert_pool_)) {
+      release_rgb(out);
+      queue_buffer(last.index);
       return false;
     }
     out.needs_release = false;
     out.plane0 = nullptr;
     out.plane1 = nullptr;
-    if (xioctl(fd_, VIDIOC_QBUF, &last) < 0) return false;
+    if (!queue_buffer(last.index)) return false;
   } else if (fourcc_ == V4L2_PIX_FMT_BGR24 && num_planes_ >= 1) {
     const uint8_t* src = static_cast<const uint8_t*>(buffers_[last.index].planes[0].start);
-    if (!bgr24_to_rgb24(src, width_, height_, out.data)) {
-      xioctl(fd_, VIDIOC_QBUF, &last);
+    uint8_t* dst = lease_rgb(out);
+    if (!dst || !bgr24_to_rgb24(src, width_, height_, dst, &convert_pool_)) {
+      release_rgb(out);
+      queue_buffer(last.index);
       return false;
     }
     out.needs_release = false;
     out.plane0 = nullptr;
     out.plane1 = nullptr;
-    if (xioctl(fd_, VIDIOC_QBUF, &last) < 0) return false;
+    if (!queue_buffer(last.index)) return false;
   } else {
     std::fprintf(stderr, "[v4l2_capture] unsupported fourcc=0x%08x planes=%u\n", fourcc_, num_planes_);
-    xioctl(fd_, VIDIOC_QBUF, &last);
+    queue_buffer(last.index);
     return false;
   }
 
   return true;
 }
 
+uint8_t* V4L2Capture::lease_rgb(V4L2Frame& out) {
+  const int slot = frame_pool_.ready() ? frame_pool_.acquire() : -1;
+  if (slot < 0) {
+    // The frame is dropped; a stalled renderer would otherwise log this once per frame.
+    frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+    if (debug_) std::fprintf(stderr, "[v4l2_capture] no free frame buffer (all leased)\n");
+    return nullptr;
+  }
+  out.pool_slot = slot;
+  out.data = frame_pool_.data(slot);
+  return frame_pool_.data(slot);
+}
+
+void V4L2Capture::release_rgb(V4L2Frame& frame) {
+  if (frame.pool_slot >= 0) frame_pool_.release(frame.pool_slot);
+  frame.pool_slot = -1;
+  frame.data = nullptr;
+}
+
 bool V4L2Capture::release_frame(V4L2Frame& frame) {
+  release_rgb(frame);
   if (!frame.needs_release) return true;
+  if (capture_thread_.joinable()) {
+    // The capture thread owns QBUF; hand the index back and wake it.
+    if (!returned_.push(frame.index)) return false;
+    frame.needs_release = false;
+    const uint64_t one = 1;
+    if (::write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) return false;
+    return true;
+  }
+  return queue_buffer(frame.index);
+}
+
+// Returns a buffer to the driver, or parks it when more buffers are in circulation than the
+// depth controller wants.
+bool V4L2Capture::queue_buffer(uint32_t index) {
+  if (index >= buffers_.size()) return false;
+  if (adaptive_depth_ && buffers_.size() - parked_.size() > depth_ctl_.depth()) {
+    end_cpu_access(index);
+    parked_.push_back(index);
+    return true;
+  }
+  return qbuf(index);
+}
+
+bool V4L2Capture::qbuf(uint32_t index) {
+  end_cpu_access(index);
+
+  Buffer& b = buffers_[index];
   v4l2_buffer buf{};
   v4l2_plane planes[VIDEO_MAX_PLANES]{};
   buf.type = buf_type_;
-  buf.memory = V4L2_MEMORY_MMAP;
-  buf.index = frame.index;
+  buf.memory = memory_;
+  buf.index = index;
   if (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
     buf.m.planes = planes;
     buf.length = num_planes_;
+    if (memory_ == V4L2_MEMORY_DMABUF) {
+      for (uint32_t p = 0; p < num_planes_ && p < (uint32_t)kMaxPlanes; p++) {
+        planes[p].m.fd = b.planes[p].fd;
+        planes[p].length = (uint32_t)b.planes[p].length;
+      }
+    }
+  } else if (memory_ == V4L2_MEMORY_DMABUF) {
+    buf.m.fd = b.planes[0].fd;
+    buf.length = (uint32_t)b.planes[0].length;
   }
   if (xioctl(fd_, VIDIOC_QBUF, &buf) < 0) return false;
-  frame.needs_release = false;
+  queued_++;
   return true;
 }
 
-void V4L2Capture::stop() {
-  if (fd_ < 0) return;
-  v4l2_buf_type type = (v4l2_buf_type)buf_type_;
-  xioctl(fd_, VIDIOC_STREAMOFF, &type);
+void V4L2Capture::note_dequeued(const v4l2_buffer& buf) {
+  if (queued_ > 0) queued_--;
+  // Sequence numbers count every frame the receiver saw, so a jump means the driver had no
+  // buffer (or dropped one). A huge jump is a restart, not a loss.
+  const uint32_t gap = buf.sequence - last_sequence_;
+  if (have_sequence_ && gap > 1 && gap < 1000) frames_lost_.fetch_add(gap - 1, std::memory_order_relaxed);
+  have_sequence_ = true;
+  last_sequence_ = buf.sequence;
+  if (!adaptive_depth_) return;
+  // Buffers out of the driver's hands other than this one: with the renderer, in the ready
+  // queue, or parked.
+  const uint32_t out = (uint32_t)buffers_.size() - queued_ - (uint32_t)parked_.size();
+  depth_ctl_.on_frame(monotonic_ns(), buf.sequence, out > 0 ? out - 1 : 0);
+  if (queued_ == 0) depth_ctl_.on_starved();
 }
 
-void V4L2Capture::close_device() {
-  for (auto& b : buffers_) {
-    if (b.dmabuf_fd >= 0) {
-      ::close(b.dmabuf_fd);
-      b.dmabuf_fd = -1;
-    }
-    for (int p = 0; p < 2; p++) {
-      if (b.planes[p].start && b.planes[p].start != MAP_FAILED) munmap(b.planes[p].start, b.planes[p].length);
-      b.planes[p].start = nullptr;
-      b.planes[p].length = 0;
-    }
+// Runs after each DQBUF batch: closes the controller's window and queues parked buffers back
+// if the depth grew. Shrinking happens lazily, as queue_buffer() parks returned buffers.
+void V4L2Capture::adapt_depth() {
+  if (!adaptive_depth_) return;
+  depth_ctl_.update(monotonic_ns());
+  while (!parked_.empty() && buffers_.size() - parked_.size() < depth_ctl_.depth()) {
+    const uint32_t index = parked_.back();
+    parked_.pop_back();
+    if (!qbuf(index)) std::fprintf(stderr, "[v4l2_capture] QBUF %u failed: %s\n", index, std::strerror(errno));
   }
-  buffers_.clear();
+}
 
-  if (fd_ >= 0) ::close(fd_);
-  fd_ = -1;
+static void dmabuf_sync(int fd, uint64_t flags) {
+  if (fd < 0) return;
+  dma_buf_sync sync{};
+  sync.flags = flags | DMA_BUF_SYNC_READ;
+  xioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
 }
 
-static inline uint8_t clamp_u8(int v) {
-  if (v < 0) return 0;
-  if (v > 255) return 255;
-  return static_cast<uint8_t>(v);
+void V4L2Capture::begin_cpu_access(uint32_t index) {
+  Buffer& b = buffers_[index];
+  if (b.cpu_access) return;
+  for (int p = 0; p < kMaxPlanes; p++) dmabuf_sync(b.planes[p].fd, DMA_BUF_SYNC_START);
+  b.cpu_access = true;
 }
 
-bool bgr24_to_rgb24(const uint8_t* bgr, uint32_t width, uint32_t height, std::vector<uint8_t>& rgb_out) {
-  if (!bgr || width == 0 || height == 0) return false;
-  rgb_out.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 3);
+void V4L2Capture::end_cpu_access(uint32_t index) {
+  Buffer& b = buffers_[index];
+  if (!b.cpu_access) return;
+  for (int p = 0; p < kMaxPlanes; p++) dmabuf_sync(b.planes[p].fd, DMA_BUF_SYNC_END);
+  b.cpu_access = false;
+}
 
-  size_t in_i = 0;
-  size_t out_i = 0;
-  const size_t pixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+bool V4L2Capture::start_capture_thread() {
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  ready_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wake_fd_ < 0 || ready_fd_ < 0) {
+    std::fprintf(stderr, "[v4l2_capture] eventfd failed: %s\n", std::strerror(errno));
+    stop_capture_thread();
+    return false;
+  }
+  ready_.clear();
+  returned_.clear();
+  capture_quit_.store(false, std::memory_order_relaxed);
+  capture_thread_ = std::thread(&V4L2Capture::capture_main, this);
+  if (debug_) std::fprintf(stderr, "[v4l2_capture] capture thread started\n");
+  return true;
+}
 
-  for (size_t i = 0; i < pixels; i++) {
-    uint8_t b = bgr[in_i + 0];
-    uint8_t g = bgr[in_i + 1];
-    uint8_t r = bgr[in_i + 2];
-    in_i += 3;
+void V4L2Capture::stop_capture_thread() {
+  if (capture_thread_.joinable()) {
+    capture_quit_.store(true, std::memory_order_relaxed);
+    const uint64_t one = 1;
+    if (::write(wake_fd_, &one, sizeof(one)) < 0) {
+      // The thread also polls with a timeout, so it exits regardless.
+    }
+    capture_thread_.join();
+  }
+  // Frames still in flight go back to the driver / frame pool.
+  V4L2Frame f;
+  while (ready_.pop(f)) {
+    release_rgb(f);
+    if (f.needs_release) queue_buffer(f.index);
+  }
+  uint32_t index = 0;
+  while (returned_.pop(index)) queue_buffer(index);
+  if (wake_fd_ >= 0) ::close(wake_fd_);
+  if (ready_fd_ >= 0) ::close(ready_fd_);
+  wake_fd_ = -1;
+  ready_fd_ = -1;
+}
 
-    rgb_out[out_i + 0] = r;
-    rgb_out[out_i + 1] = g;
-    rgb_out[out_i + 2] = b;
-    out_i += 3;
+void V4L2Capture::capture_main() {
+  pthread_setname_np(pthread_self(), "capture");
+  const size_t ready_keep = frame_policy_ == FramePolicy::Latest ? 1 : kMaxBacklog;
+  {
+    v4l2_buffer buf{};
+    v4l2_plane planes[VIDEO_MAX_PLANES]{};
+    V4L2Frame f;
+    if (take_warm_frame(buf, planes) && fill_frame(buf, f)) {
+      if (ready_.push(f)) {
+        const uint64_t one = 1;
+        if (::write(ready_fd_, &one, sizeof(one)) < 0) {
+          // Counter saturation is harmless; the consumer drains the ring anyway.
+        }
+      } else {
+        release_rgb(f);
+        if (f.needs_release) queue_buffer(f.index);
+      }
+    }
   }
 
-  (void)clamp_u8;
-  return true;
+  while (!capture_quit_.load(std::memory_order_relaxed)) {
+    pollfd pfds[2]{};
+    pfds[0].fd = fd_;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = wake_fd_;
+    pfds[1].events = POLLIN;
+    const int pr = poll(pfds, 2, 100);
+    if (pr < 0 && errno != EINTR) {
+      std::fprintf(stderr, "[v4l2_capture] capture thread poll failed: %s\n", std::strerror(errno));
+      break;
+    }
+
+    if (pfds[1].revents & POLLIN) {
+      uint64_t n = 0;
+      if (::read(wake_fd_, &n, sizeof(n)) < 0) {
+        // EAGAIN: already drained.
+      }
+    }
+    uint32_t index = 0;
+    while (returned_.pop(index)) {
+      if (!queue_buffer(index)) std::fprintf(stderr, "[v4l2_capture] QBUF %u failed: %s\n", index, std::strerror(errno));
+    }
+    if (!(pfds[0].revents & POLLIN)) {
+      // POLLERR: nothing queued (every buffer is with the renderer) or the driver stopped the
+      // queue on a source change. Only a returned buffer or stop() can help, so wait for those.
+      if (pfds[0].revents & POLLERR) poll(&pfds[1], 1, 100);
+      continue;
+    }
+
+    bool published = false;
+    while (true) {
+      v4l2_buffer buf{};
+      v4l2_plane planes[VIDEO_MAX_PLANES]{};
+      buf.type = buf_type_;
+      buf.memory = memory_;
+      if (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        buf.m.planes = planes;
+        buf.length = num_planes_;
+      }
+      if (xioctl(fd_, VIDIOC_DQBUF, &buf) < 0) {
+        if (errno != EAGAIN) std::fprintf(stderr, "[v4l2_capture] DQBUF failed: %s\n", std::strerror(errno));
+        break;
+      }
+      note_dequeued(buf);
+
+      // While the consumer is behind, drop the oldest published frames rather than the new
+      // one: their buffers and frame-pool slots go back, so capture keeps delivering the
+      // newest picture. Latest only ever shows the newest ready frame; FIFO/paced keep up to
+      // a backlog's worth.
+      V4L2Frame old;
+      while (ready_.size() >= ready_keep && ready_.discard_oldest(old)) {
+        release_rgb(old);
+        if (old.needs_release) queue_buffer(old.index);
+        frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      V4L2Frame f;
+      if (!fill_frame(buf, f)) continue;
+      if (!ready_.push(f)) {
+        release_rgb(f);
+        if (f.needs_release) queue_buffer(f.index);
+        frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      published = true;
+    }
+    adapt_depth();
+
+    if (published) {
+      const uint64_t one = 1;
+      if (::write(ready_fd_, &one, sizeof(one)) < 0) {
+        // Counter saturation is harmless; the consumer drains the ring anyway.
+      }
+    }
+  }
 }
 
-bool nv12_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height, uint32_t y_stride, uint32_t uv_stride, bool uv_swap, std::vector<uint8_t>& rgb_out) {
-  if (!y_plane || !uv_plane || width == 0 || height == 0) return false;
-  if (y_stride == 0) y_stride = width;
-  if (uv_stride == 0) uv_stride = y_stride;
+bool V4L2Capture::acquire_from_thread(V4L2Frame& out) {
+  // Reset the eventfd before draining so a frame published meanwhile signals it again.
+  uint64_t n = 0;
+  if (::read(ready_fd_, &n, sizeof(n)) < 0) {
+    // EAGAIN: nothing new since the last acquire.
+  }
 
-  rgb_out.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 3);
+  // Keep only the newest ready frame, like the direct path's drain to latest.
+  V4L2Frame f;
+  bool have = false;
+  while (ready_.pop(f)) {
+    if (have) {
+      if (!release_frame(out)) return false;
+      frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    out = f;
+    have = true;
+  }
+  return true;
+}
 
-  for (uint32_t y = 0; y < height; y++) {
-    const uint8_t* yrow = y_plane + static_cast<size_t>(y) * y_stride;
-    const uint8_t* uvrow = uv_plane + static_cast<size_t>(y / 2) * uv_stride;
+// Appends a filled frame for the FIFO/paced policies. When the backlog is full the oldest
+// frame is dropped: it would be shown late anyway, and its buffer is better back with the driver.
+void V4L2Capture::push_backlog(const V4L2Frame& f) {
+  const uint32_t limit = backlog_limit();
+  if (backlog_count_ >= limit) {
+    release_frame(backlog_[0]);
+    frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+    for (uint32_t i = 1; i < backlog_count_; i++) backlog_[i - 1] = backlog_[i];
+    backlog_count_--;
+  }
+  backlog_[backlog_count_++] = f;
+}
+
+// Hands over the warm-up frame kept by start(), once. `planes` must hold VIDEO_MAX_PLANES.
+bool V4L2Capture::take_warm_frame(v4l2_buffer& buf, v4l2_plane* planes) {
+  if (!warm_pending_) return false;
+  warm_pending_ = false;
+  buf = v4l2_buffer{};
+  buf.type = buf_type_;
+  buf.memory = memory_;
+  buf.index = warm_index_;
+  buf.sequence = warm_sequence_;
+  buf.timestamp.tv_sec = (time_t)warm_ts_sec_;
+  buf.timestamp.tv_usec = (suseconds_t)warm_ts_usec_;
+  if (buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+    std::memset(planes, 0, sizeof(v4l2_plane) * VIDEO_MAX_PLANES);
+    buf.m.planes = planes;
+    buf.length = num_planes_;
+  }
+  return true;
+}
 
-    for (uint32_t x = 0; x < width; x++) {
-      int Y = (int)yrow[x] - 16;
-      int U = (int)uvrow[(x & ~1) + (uv_swap ? 1 : 0)] - 128;
-      int V = (int)uvrow[(x & ~1) + (uv_swap ? 0 : 1)] - 128;
-      if (Y < 0) Y = 0;
+// CPU-converted frames hold frame-pool slots, and start() reserves a full backlog of those.
+// Zero-copy frames hold capture buffers: leave enough for the driver to fill and for the
+// renderer to hold (two in flight). configure() requests enough for a full backlog, but the
+// driver may grant fewer.
+uint32_t V4L2Capture::backlog_limit() const {
+  if (frame_pool_.ready()) return kMaxBacklog;
+  const uint32_t n = (uint32_t)buffers_.size();
+  return std::min(kMaxBacklog, n > 4 ? n - 3 : 1u);
+}
 
-      int C = 298 * Y;
-      int r = (C + 409 * V + 128) >> 8;
-      int g = (C - 100 * U - 208 * V + 128) >> 8;
-      int b = (C + 516 * U + 128) >> 8;
+bool V4L2Capture::pick_from_backlog(V4L2Frame& out, uint64_t present_ns) {
+  if (backlog_count_ == 0) return true;
 
-      size_t oi = (static_cast<size_t>(y) * width + x) * 3;
-      rgb_out[oi + 0] = clamp_u8(r);
-      rgb_out[oi + 1] = clamp_u8(g);
-      rgb_out[oi + 2] = clamp_u8(b);
+  uint32_t pick = 0;
+  if (frame_policy_ == FramePolicy::Paced) {
+    const uint64_t newest_ts = frame_ts_ns(backlog_[backlog_count_ - 1]);
+    if (present_ns == 0 || newest_ts == 0 || newest_ts >= present_ns) {
+      // No usable clock: behave like latest.
+      pick = backlog_count_ - 1;
+    } else {
+      // Aim for frames as old as the newest one usually is at its vblank. Holding that
+      // offset steady spaces the shown frames evenly in capture time, where always taking
+      // the newest makes the offset saw-tooth as the two rates drift past each other.
+      const uint64_t age = present_ns - newest_ts;
+      if (pace_delay_ns_ == 0) {
+        pace_delay_ns_ = age;
+      } else {
+        pace_delay_ns_ = (uint64_t)((int64_t)pace_delay_ns_ + ((int64_t)age - (int64_t)pace_delay_ns_) / 16);
+      }
+      const int64_t target = (int64_t)(present_ns - pace_delay_ns_);
+      int64_t best = INT64_MAX;
+      for (uint32_t i = 0; i < backlog_count_; i++) {
+        const int64_t d = std::llabs((int64_t)frame_ts_ns(backlog_[i]) - target);
+        if (d < best) {
+          best = d;
+          pick = i;
+        }
+      }
     }
   }
 
+  for (uint32_t i = 0; i < pick; i++) {
+    if (!release_frame(backlog_[i])) return false;
+    frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+  out = backlog_[pick];
+  for (uint32_t i = pick + 1; i < backlog_count_; i++) backlog_[i - pick - 1] = backlog_[i];
+  backlog_count_ -= pick + 1;
   return true;
 }
+
+void V4L2Capture::flush_backlog() {
+  for (uint32_t i = 0; i < backlog_count_; i++) release_frame(backlog_[i]);
+  backlog_count_ = 0;
+}
+
+void V4L2Capture::stop() {
+  stop_capture_thread();
+  flush_backlog();
+  if (fd_ < 0) return;
+  v4l2_buf_type type = (v4l2_buf_type)buf_type_;
+  xioctl(fd_, VIDIOC_STREAMOFF, &type);
+  // STREAMOFF hands every queued buffer back, and reclaims a warm-up frame never acquired.
+  queued_ = 0;
+  warm_pending_ = false;
+}
+
+void V4L2Capture::close_device() {
+  stop_capture_thread();
+  flush_backlog();
+  convert_pool_.stop();
+  release_buffers();
+
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+}
@@ -1,24 +1,63 @@
 #pragma once
 
+#include "colorimetry.h"
+#include "convert_pool.h"
+#include "dmabuf_alloc.h"
+#include "format_plan.h"
+#include "frame_pool.h"
+#include "latest_ring.h"
+#include "queue_depth.h"
+#include "spsc_ring.h"
+
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <thread>
 #include <vector>
 
+struct v4l2_buffer;
+struct v4l2_plane;
+
+// Which ready frame acquire_frame() hands out when several have arrived since the last call.
+enum class FramePolicy : uint8_t {
+  Latest = 0,  // the newest; older ones are requeued (lowest latency, judders when rates beat)
+  Fifo = 1,    // every frame in order, a small backlog absorbing rate differences
+  Paced = 2,   // the one whose capture time best matches the vblank it will be shown at
+};
+
+const char* frame_policy_name(FramePolicy p);
+// Accepts latest, fifo or paced.
+bool parse_frame_policy(const std::string& s, FramePolicy& out);
+
+// One plane of a capture buffer as seen by an EGL/KMS importer.
+struct DmabufPlane {
+  int fd = -1;
+  uint32_t offset = 0;
+  uint32_t pitch = 0;
+};
+
 struct V4L2Frame {
   uint32_t width = 0;
   uint32_t height = 0;
   uint32_t fourcc = 0;
-  std::vector<uint8_t> data;
+  // Tightly packed RGB24 from the CPU conversion paths: a lease into the capture's frame pool,
+  // valid until release_frame().
+  const uint8_t* data = nullptr;
+  int pool_slot = -1;
 
   uint32_t num_planes = 0;
   uint32_t y_stride = 0;
   uint32_t uv_stride = 0;
   const uint8_t* plane0 = nullptr;
   const uint8_t* plane1 = nullptr;
+  // V plane of 3-plane formats (YUV420M); U is plane1 and both use uv_stride.
+  const uint8_t* plane2 = nullptr;
   uint32_t index = 0;
   bool needs_release = false;
 
+  // v4l2_buffer.sequence and .timestamp (CLOCK_MONOTONIC on current drivers).
+  uint32_t sequence = 0;
   int64_t ts_sec = 0;
   int64_t ts_usec = 0;
 };
@@ -28,30 +67,123 @@ public:
   bool open_device(const std::string& devnode);
   bool configure(uint32_t width, uint32_t height);
   bool start();
-  bool acquire_frame(V4L2Frame& out);
+  // Non-blocking: hands out a ready buffer chosen by the frame policy, or returns with
+  // needs_release=false when there is none. Wait for event_fd() to become readable first, or
+  // call again while backlog_pending(). `present_ns` is the CLOCK_MONOTONIC time of the vblank
+  // the frame will be shown at (0 if unknown); only the paced policy uses it.
+  bool acquire_frame(V4L2Frame& out, uint64_t present_ns = 0);
   bool release_frame(V4L2Frame& frame);
   void stop();
   void close_device();
 
+  // Drains pending V4L2 events (the device fd polls POLLPRI while any are queued) and reports
+  // whether the input resolution or format changed.
+  bool dequeue_events(bool& source_changed);
+  // After stop(): frees the buffers, adopts the receiver's current DV timings and runs
+  // configure() again. Fails while the input has no stable signal. Every EGLImage imported
+  // from dmabuf_fd() must be destroyed first, or the driver keeps the old buffers busy.
+  bool reconfigure(uint32_t width, uint32_t height);
+
   void set_nv12_uv_swap(bool swap) { nv12_uv_swap_ = swap; }
   void set_debug(bool dbg) { debug_ = dbg; }
   void set_request_buffer_count(uint32_t n) { reqbuf_count_ = n; }
+  // Threads used for BGR24/YUYV/UYVY conversion (0 = auto, 1 = render thread only).
+  void set_convert_threads(uint32_t n) { convert_threads_ = n; }
+  // Hand YUYV/UYVY buffers to the renderer untouched instead of converting them on the CPU.
+  void set_gpu_yuv422(bool enable) { gpu_yuv422_ = enable; }
+  // Same for BGR24; the renderer swaps R/B in the shader.
+  void set_gpu_bgr24(bool enable) { gpu_bgr24_ = enable; }
+  // Run DQBUF/QBUF (and CPU conversion) on a dedicated thread; acquire_frame() then only pops
+  // the newest ready frame and never touches the V4L2 fd.
+  void set_capture_thread(bool enable) { use_capture_thread_ = enable; }
+  // Import buffers from `alloc` (V4L2_MEMORY_DMABUF) instead of using driver MMAP buffers.
+  // Takes effect at the next configure(); falls back to MMAP if the driver refuses.
+  void set_dmabuf_allocator(const DmabufAllocator& alloc) { dmabuf_alloc_ = alloc; }
+  // Whether the renderer reads plane0/plane1 with the CPU (texture uploads). Imported
+  // buffers are then cache-synced around each frame; zero-copy frames skip the sync.
+  void set_cpu_plane_access(bool enable) { cpu_plane_access_.store(enable, std::memory_order_relaxed); }
+  // Enables cost-ranked format negotiation in configure(): offered formats are scored against
+  // what the renderer can import and the cheapest is requested first. Without it (or if no
+  // candidate sticks) the fixed BGR24/NV12/.../UYVY order is used.
+  void set_import_caps(const ImportCaps& caps) {
+    import_caps_ = caps;
+    plan_formats_ = true;
+  }
+  // Treat the REQBUFS count as a ceiling and let a QueueDepthController decide how many
+  // buffers circulate; the rest are parked (kept back from QBUF) until drops call for them.
+  void set_adaptive_depth(bool enable) { adaptive_depth_ = enable; }
+  // Takes effect at the next start().
+  void set_frame_policy(FramePolicy p) { frame_policy_ = p; }
+  // Capture timestamp to page-flip completion of a displayed frame; only logged by the
+  // controller. Safe to call from the render thread.
+  void note_present_latency(uint64_t ns) {
+    if (adaptive_depth_) depth_ctl_.on_latency(ns);
+  }
 
   uint32_t width() const { return width_; }
   uint32_t height() const { return height_; }
   uint32_t fourcc() const { return fourcc_; }
+  Colorimetry colorimetry() const { return colorimetry_; }
+  // True when every plane of every buffer has a dmabuf fd (exported or imported).
   bool dmabuf_export_supported() const { return dmabuf_export_supported_; }
+  // fd of plane 0, for single-plane formats.
   int dmabuf_fd(uint32_t index) const;
+  // Plane 0 (luma/packed), 1 (chroma, or U) or 2 (V, 3-plane formats only) of buffer `index`:
+  // its own fd for multi-planar formats (NV12M, NV16M, YUV420M), an offset into plane 0's fd
+  // for contiguous ones (NV12, NV16, NV24).
+  bool dmabuf_plane(uint32_t index, uint32_t plane, DmabufPlane& out) const;
   uint32_t buffer_count() const { return (uint32_t)buffers_.size(); }
+  // Readable when acquire_frame() has something: the V4L2 fd, or the capture thread's
+  // ready eventfd once start() has launched it.
+  int event_fd() const { return capture_thread_.joinable() ? ready_fd_ : fd_; }
+  // The V4L2 fd itself; POLLPRI on it signals queued events.
+  int device_fd() const { return fd_; }
+  bool source_change_events() const { return source_change_events_; }
+  // Frames kept back by the FIFO/paced policies for later acquire_frame() calls.
+  bool backlog_pending() const { return backlog_count_ > 0; }
+  // Captured frames that were never handed out: skipped by the policy, or overflowing a queue.
+  uint64_t frames_dropped() const { return frames_dropped_.load(std::memory_order_relaxed); }
+  // Frames the driver never delivered: gaps in v4l2_buffer.sequence since start().
+  uint64_t frames_lost() const { return frames_lost_.load(std::memory_order_relaxed); }
 
 private:
+  static constexpr int kMaxPlanes = 3;
+  static constexpr uint32_t kMaxBacklog = 4;
+
+  bool apply_dv_timings();
+  void release_buffers();
+  void align_bytesperline(uint32_t type);
+  std::vector<FormatPlan> plan_formats(uint32_t type, uint32_t width, uint32_t height);
+  bool allocate_dmabuf_buffers(uint32_t count, const size_t* sizes);
+  void begin_cpu_access(uint32_t index);
+  void end_cpu_access(uint32_t index);
+  bool fill_frame(v4l2_buffer& buf, V4L2Frame& out);
+  bool queue_buffer(uint32_t index);
+  bool qbuf(uint32_t index);
+  void note_dequeued(const v4l2_buffer& buf);
+  void adapt_depth();
+  uint8_t* lease_rgb(V4L2Frame& out);
+  void release_rgb(V4L2Frame& frame);
+
+  bool start_capture_thread();
+  void stop_capture_thread();
+  void capture_main();
+  bool acquire_from_thread(V4L2Frame& out);
+  void push_backlog(const V4L2Frame& f);
+  bool pick_from_backlog(V4L2Frame& out, uint64_t present_ns);
+  uint32_t backlog_limit() const;
+  bool take_warm_frame(v4l2_buffer& buf, v4l2_plane* planes);
+  void flush_backlog();
+
   int fd_ = -1;
   uint32_t buf_type_ = 0;
+  uint32_t memory_ = 1;  // V4L2_MEMORY_MMAP or V4L2_MEMORY_DMABUF
   uint32_t width_ = 0;
   uint32_t height_ = 0;
   uint32_t fourcc_ = 0;
   uint32_t bytes_per_frame_ = 0;
   uint32_t num_planes_ = 0;
+  Colorimetry colorimetry_;
 
   uint32_t y_stride_ = 0;
   uint32_t uv_stride_ = 0;
@@ -59,22 +191,69 @@ private:
   bool nv12_uv_swap_ = false;
 
   bool dmabuf_export_supported_ = false;
+  bool source_change_events_ = false;
   bool debug_ = false;
   uint32_t reqbuf_count_ = 4;
+  uint32_t convert_threads_ = 0;
+  bool gpu_yuv422_ = false;
+  bool gpu_bgr24_ = false;
+  DmabufAllocator dmabuf_alloc_;
+  ImportCaps import_caps_;
+  bool plan_formats_ = false;
+  std::atomic_bool cpu_plane_access_{true};
+
+  // Adaptive depth: queued_ counts buffers owned by the driver, parked_ the ones held back.
+  // Both are only touched by whichever thread does DQBUF/QBUF.
+  bool adaptive_depth_ = false;
+  QueueDepthController depth_ctl_;
+  uint32_t queued_ = 0;
+  std::vector<uint32_t> parked_;
+
+  // The first good frame of start()'s warm-up, kept dequeued for the first acquire: just what
+  // fill_frame() reads from its v4l2_buffer.
+  bool warm_pending_ = false;
+  uint32_t warm_index_ = 0;
+  uint32_t warm_sequence_ = 0;
+  int64_t warm_ts_sec_ = 0;
+  int64_t warm_ts_usec_ = 0;
+
+  FramePolicy frame_policy_ = FramePolicy::Latest;
+  // Consumer-side only. Oldest first; each entry owns its buffer / frame-pool lease.
+  V4L2Frame backlog_[kMaxBacklog];
+  uint32_t backlog_count_ = 0;
+  // Smoothed age of the newest frame at its vblank; the paced policy aims for frames this old.
+  uint64_t pace_delay_ns_ = 0;
+  std::atomic<uint64_t> frames_dropped_{0};
+  // Sequence tracking; owned by whichever thread does DQBUF.
+  bool have_sequence_ = false;
+  uint32_t last_sequence_ = 0;
+  std::atomic<uint64_t> frames_lost_{0};
+
+  ConvertPool convert_pool_;
+  // Destination buffers for the CPU conversion paths, sized in start().
+  FramePool frame_pool_;
+
+  // Capture thread state: ready_ carries frames to the render thread (the capture thread
+  // discards the oldest while the renderer is behind), returned_ carries buffer indices back
+  // for QBUF. wake_fd_ wakes the capture thread, ready_fd_ the consumer.
+  bool use_capture_thread_ = false;
+  std::thread capture_thread_;
+  std::atomic_bool capture_quit_{false};
+  LatestRing<V4L2Frame, 64> ready_;
+  SpscRing<uint32_t, 64> returned_;
+  int wake_fd_ = -1;
+  int ready_fd_ = -1;
 
   struct Plane {
     void* start = nullptr;
     size_t length = 0;
+    int fd = -1;  // VIDIOC_EXPBUF export (MMAP) or the imported buffer (DMABUF)
   };
 
   struct Buffer {
-    Plane planes[2];
-    int dmabuf_fd = -1;
+    Plane planes[kMaxPlanes];
+    bool cpu_access = false;  // between DMA_BUF_SYNC_START and _END
   };
 
   std::vector<Buffer> buffers_;
 };
-
-bool bgr24_to_rgb24(const uint8_t* bgr, uint32_t width, uint32_t height, std::vector<uint8_t>& rgb_out);
-bool nv12_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height, uint32_t y_stride, uint32_t uv_stride, bool uv_swap, std::vector<uint8_t>& rgb_out);
-bool nv24_to_rgb24(const uint8_t* y_plane, const uint8_t* uv_plane, uint32_t width, uint32_t height, uint32_t y_stride, uint32_t uv_stride, bool uv_swap, std::vector<uint8_t>& rgb_out);